@@ -0,0 +1,576 @@
+/**
+ * @file    archive.cpp
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ *
+ * Reader for asset images held in a tar or zip file, so that the assets
+ * don't need to be extracted before the cards are drawn.
+ */
+
+#include "archive.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <iostream>
+
+
+/**
+ * @section Internal constants and variables.
+ *
+ */
+
+static const size_t BLOCK = 512;            // Size of a tar block.
+
+static const uint32_t ZIP_LOCAL = 0x04034B50;
+static const uint32_t ZIP_CENTRAL = 0x02014B50;
+static const uint32_t ZIP_END = 0x06054B50;
+
+assetArchive archiveFiles;
+
+
+/**
+ * @section main code.
+ *
+ */
+
+/**
+ * Get a number from a tar header field, which is either octal text or, for
+ * large values, base-256 flagged by the top bit of the first byte.
+ *
+ * @param  field - the field.
+ * @param  length - length of the field.
+ * @return the number.
+ */
+static long long getNumber(const uint8_t * field, size_t length)
+{
+    long long value = 0;
+    if (field[0] & 0x80)
+    {
+        value = field[0] & 0x7F;
+        for (size_t i = 1; i < length; ++i)
+        {
+            value = (value << 8) | field[i];
+        }
+
+        return value;
+    }
+
+    for (size_t i = 0; (i < length) && (field[i]); ++i)
+    {
+        if ((field[i] >= '0') && (field[i] <= '7'))
+        {
+            value = value * 8 + (field[i] - '0');
+        }
+        else if (field[i] != ' ')
+        {
+            break;
+        }
+    }
+
+    return value;
+}
+
+
+/**
+ * Get a text field of a tar header, which is only terminated if it is
+ * shorter than the field.
+ *
+ * @param  field - the field.
+ * @param  length - length of the field.
+ * @return the text.
+ */
+static string getText(const uint8_t * field, size_t length)
+{
+    const char * text = (const char *)field;
+
+    return string(text, strnlen(text, length));
+}
+
+
+/**
+ * Get the path from the records of a pax extended header. Each record is
+ * "length key=value\n", where length counts the whole record.
+ *
+ * @param  text - the records.
+ * @param  size - length of the records.
+ * @return the path, or an empty string if there isn't one.
+ */
+static string getPaxPath(const char * text, size_t size)
+{
+    size_t pos = 0;
+    while (pos < size)
+    {
+        const size_t length = strtoul(text + pos, NULL, 10);
+        const char * space = (const char *)memchr(text + pos, ' ', size - pos);
+        if ((!length) || (!space) || (length > size - pos) || (space >= text + pos + length))
+            break;
+
+        const string record(space + 1, text + pos + length - 1);
+        if (record.compare(0, 5, "path=") == 0)
+        {
+            return record.substr(5);
+        }
+        pos += length;
+    }
+
+    return string();
+}
+
+
+/**
+ * Get a 16-bit little endian number from a zip record.
+ *
+ * @param  p - the first byte of the number.
+ * @return the number.
+ */
+static inline uint32_t getU16(const uint8_t * p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+
+/**
+ * Get a 32-bit little endian number from a zip record.
+ *
+ * @param  p - the first byte of the number.
+ * @return the number.
+ */
+static inline uint32_t getU32(const uint8_t * p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24);
+}
+
+
+/**
+ * Get the time of a zip member from its MS-DOS date and time.
+ *
+ * @param  date - the date.
+ * @param  time - the time.
+ * @return the time in seconds since the epoch.
+ */
+static long long getDosTime(uint32_t date, uint32_t time)
+{
+    struct tm t;
+    memset(&t, 0, sizeof(t));
+    t.tm_year = ((date >> 9) & 0x7F) + 80;
+    t.tm_mon = ((date >> 5) & 0x0F) - 1;
+    t.tm_mday = date & 0x1F;
+    t.tm_hour = time >> 11;
+    t.tm_min = (time >> 5) & 0x3F;
+    t.tm_sec = (time & 0x1F) * 2;
+
+    return timegm(&t);
+}
+
+
+/**
+ * Unmap the archive.
+ *
+ */
+assetArchive::~assetArchive(void)
+{
+    if (Map)
+    {
+        munmap(Map, MapSize);
+    }
+}
+
+
+/**
+ * Add a file of the archive to the index. Directories are left out, as only
+ * the files in them are looked up.
+ *
+ * @param  name - name of the file in the archive.
+ * @param  data - the contents, in the mapped archive.
+ * @param  size - length of the contents.
+ * @param  mtime - modification time.
+ */
+void assetArchive::addMember(string name, const uint8_t * data, size_t size, long long mtime)
+{
+    while (name.compare(0, 2, "./") == 0)
+    {
+        name.erase(0, 2);
+    }
+    if ((name.empty()) || (name[name.length() - 1] == '/'))
+    {
+        return;
+    }
+
+    const member file = { data, size, mtime };
+    if (Members.insert(make_pair(name, file)).second)
+    {
+        const size_t slash = name.rfind('/') + 1;
+        Listing[name.substr(0, slash)].push_back(name.substr(slash));
+    }
+    else
+    {
+        // A later copy of a file replaces the earlier one, as tar does.
+        Members[name] = file;
+    }
+}
+
+
+/**
+ * Index the files of a tar archive, reading the name of each from a ustar
+ * header, or from a GNU long name or pax extended header before it.
+ *
+ * @return error value or 0 if no errors.
+ */
+int assetArchive::indexTar(void)
+{
+    const uint8_t * base = (const uint8_t *)Map;
+    string longName;
+    size_t offset = 0;
+    while (offset + BLOCK <= MapSize)
+    {
+        const uint8_t * header = base + offset;
+        if (!header[0])
+            break;
+
+        const long long size = getNumber(header + 124, 12);
+        const size_t data = offset + BLOCK;
+        if ((size < 0) || (size_t(size) > MapSize - data))
+        {
+            return 1;
+        }
+
+        const char type = header[156];
+        if (type == 'L')
+        {
+            longName = getText(base + data, size);
+        }
+        else if (type == 'x')
+        {
+            const string path = getPaxPath((const char *)(base + data), size);
+            if (path.length())
+                longName = path;
+        }
+        else if (type != 'g')
+        {
+            if ((type == '0') || (type == '\0') || (type == '7'))
+            {
+                string name = longName;
+                if (name.empty())
+                {
+                    name = getText(header, 100);
+                    if ((memcmp(header + 257, "ustar\0", 6) == 0) && (header[345]))
+                        name = getText(header + 345, 155) + "/" + name;
+                }
+                addMember(name, base + data, size, getNumber(header + 136, 12));
+            }
+            longName.clear();
+        }
+
+        offset = data + (size + BLOCK - 1) / BLOCK * BLOCK;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Index the files of a zip archive from its central directory. The files
+ * must be stored, as compressed files can't be read in place.
+ *
+ * @return error value or 0 if no errors.
+ */
+int assetArchive::indexZip(void)
+{
+    const uint8_t * base = (const uint8_t *)Map;
+    if (MapSize < 22)
+    {
+        return 1;
+    }
+
+//- Find the end record, which may be followed by a comment.
+    const uint8_t * end = NULL;
+    for (size_t i = MapSize - 22; ; --i)
+    {
+        if (getU32(base + i) == ZIP_END)
+        {
+            end = base + i;
+            break;
+        }
+        if ((i == 0) || (MapSize - i >= 22 + 0xFFFF))
+            break;
+    }
+
+    if (!end)
+    {
+        return 1;
+    }
+
+    const uint32_t count = getU16(end + 10);
+    const uint32_t length = getU32(end + 12);
+    const uint32_t start = getU32(end + 16);
+    if ((count == 0xFFFF) || (start == 0xFFFFFFFF) || (start > MapSize) || (length > MapSize - start))
+    {
+        return 1;
+    }
+
+//- Read the central directory.
+    const uint8_t * p = base + start;
+    const uint8_t * last = p + length;
+    size_t compressed = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if ((last - p < 46) || (getU32(p) != ZIP_CENTRAL))
+        {
+            return 1;
+        }
+
+        const uint32_t method = getU16(p + 10);
+        const uint32_t size = getU32(p + 24);
+        const uint32_t nameLength = getU16(p + 28);
+        const uint32_t local = getU32(p + 42);
+        const string name((const char *)p + 46, nameLength);
+        const long long mtime = getDosTime(getU16(p + 14), getU16(p + 12));
+        p += 46 + nameLength + getU16(p + 30) + getU16(p + 32);
+
+        if ((name.empty()) || (name[name.length() - 1] == '/'))
+            continue;
+
+        if (method != 0)
+        {
+            ++compressed;
+            continue;
+        }
+
+        if ((local > MapSize - 30) || (getU32(base + local) != ZIP_LOCAL))
+        {
+            return 1;
+        }
+
+        const size_t data = size_t(local) + 30 + getU16(base + local + 26) + getU16(base + local + 28);
+        if ((data > MapSize) || (size > MapSize - data))
+        {
+            return 1;
+        }
+
+        addMember(name, base + data, size, mtime);
+    }
+
+    if (compressed)
+    {
+        cerr << compressed << " files in the asset archive are compressed, store them with 'zip -0' - aborting!" << endl;
+
+        return 2;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Find the top directory that every file of the archive is in, if there is
+ * one.
+ *
+ */
+void assetArchive::findPrefix(void)
+{
+    Prefix.clear();
+    for (unordered_map<string, member>::const_iterator it = Members.begin(); it != Members.end(); ++it)
+    {
+        const size_t slash = it->first.find('/');
+        if (slash == string::npos)
+        {
+            Prefix.clear();
+
+            return;
+        }
+
+        if (Prefix.empty())
+        {
+            Prefix = it->first.substr(0, slash + 1);
+        }
+        else if (it->first.compare(0, Prefix.length(), Prefix) != 0)
+        {
+            Prefix.clear();
+
+            return;
+        }
+    }
+}
+
+
+/**
+ * Map an archive into memory and index its files.
+ *
+ * @param  fileName - name of the tar or zip file.
+ * @return error value or 0 if no errors.
+ */
+int assetArchive::open(const string & fileName)
+{
+    const int fd = ::open(fileName.c_str(), O_RDONLY);
+    struct stat info;
+    if ((fd < 0) || (fstat(fd, &info)) || (info.st_size < 4))
+    {
+        if (fd >= 0)
+            close(fd);
+        cerr << "Can't read asset archive " << fileName << " - aborting!" << endl;
+
+        return 1;
+    }
+
+    MapSize = info.st_size;
+    Map = mmap(NULL, MapSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (Map == MAP_FAILED)
+    {
+        Map = NULL;
+        cerr << "Can't map asset archive " << fileName << " - aborting!" << endl;
+
+        return 1;
+    }
+
+    const uint8_t * base = (const uint8_t *)Map;
+    int ret = 0;
+    if ((base[0] == 0x1F) && (base[1] == 0x8B))
+    {
+        cerr << "Asset archive " << fileName << " is compressed, unpack it with gunzip first - aborting!" << endl;
+
+        return 1;
+    }
+
+    if ((base[0] == 'P') && (base[1] == 'K'))
+    {
+        ret = indexZip();
+    }
+    else if ((MapSize >= BLOCK) && (memcmp(base + 257, "ustar", 5) == 0))
+    {
+        ret = indexTar();
+    }
+    else
+    {
+        cerr << "Asset archive " << fileName << " is not a tar or zip file - aborting!" << endl;
+
+        return 1;
+    }
+
+    if (ret == 1)
+    {
+        cerr << "Asset archive " << fileName << " is damaged - aborting!" << endl;
+    }
+    if (ret)
+    {
+        return 1;
+    }
+
+    findPrefix();
+
+    return 0;
+}
+
+
+/**
+ * Find a file in the archive, either as named or under the top directory.
+ *
+ * @param  fileName - name of the file.
+ * @return the file or NULL if it isn't in the archive.
+ */
+const assetArchive::member * assetArchive::find(const string & fileName) const
+{
+    unordered_map<string, member>::const_iterator it = Members.find(fileName);
+    if ((it == Members.end()) && (Prefix.length()))
+    {
+        it = Members.find(Prefix + fileName);
+    }
+
+    return (it == Members.end()) ? NULL : &it->second;
+}
+
+
+/**
+ * Get the contents of a file in the archive, in place.
+ *
+ * @param  fileName - name of the file.
+ * @param  data - returns the contents.
+ * @param  size - returns the length of the contents.
+ * @return true if the file is in the archive, false otherwise.
+ */
+bool assetArchive::read(const string & fileName, const uint8_t * & data, size_t & size) const
+{
+    const member * file = find(fileName);
+    if (!file)
+    {
+        return false;
+    }
+
+    data = file->Data;
+    size = file->Size;
+
+    return true;
+}
+
+
+/**
+ * Get the status of a file, from the archive if it is in it, otherwise from
+ * the file system.
+ *
+ * @param  fileName - name of the file.
+ * @param  info - returns the status.
+ * @return error value or 0 if no errors.
+ */
+int assetArchive::getStatus(const string & fileName, struct stat & info) const
+{
+    const member * file = find(fileName);
+    if (!file)
+    {
+        return stat(fileName.c_str(), &info);
+    }
+
+    memset(&info, 0, sizeof(info));
+    info.st_mode = S_IFREG | 0444;
+    info.st_size = file->Size;
+    info.st_mtime = file->MTime;
+
+    return 0;
+}
+
+
+/**
+ * Get the names of the files in a directory of the archive.
+ *
+ * @param  directory - the directory, ending with '/', or empty for the top.
+ * @param  names - the names are added to this list.
+ * @return true if the archive has the directory, false otherwise.
+ */
+bool assetArchive::list(const string & directory, vector<string> & names) const
+{
+    unordered_map<string, vector<string> >::const_iterator it = Listing.find(directory);
+    if ((it == Listing.end()) && (Prefix.length()))
+    {
+        it = Listing.find(Prefix + directory);
+    }
+
+    if (it == Listing.end())
+    {
+        return false;
+    }
+
+    names.insert(names.end(), it->second.begin(), it->second.end());
+
+    return true;
+}
+
@@ -0,0 +1,85 @@
+/**
+ * @file    archive.h
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ * Interface for the assetArchive class.
+ */
+
+#if !defined _ARCHIVE_H_INCLUDED_
+#define _ARCHIVE_H_INCLUDED_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <sys/stat.h>
+
+using namespace std;
+
+
+/**
+ * @section assetArchive class.
+ *
+ * Used to read the asset images straight from an uncompressed tar file or a
+ * zip file of stored members, instead of from the extracted files. The
+ * archive is mapped into memory and its members are indexed once, when it is
+ * opened, so each member can then be read in place. Names are looked up as
+ * they are, then under the top directory of the archive if every member is
+ * in one, so an archive of 'CardWork/' can be used from inside it. Files that
+ * are not in the archive are read from the file system as usual.
+ */
+class assetArchive
+{
+private:
+    struct member
+    {
+        const uint8_t * Data;
+        size_t Size;
+        long long MTime;
+    };
+
+    void * Map;                 // The mapped archive, or NULL.
+    size_t MapSize;
+    string Prefix;              // Top directory of every member, if any.
+    unordered_map<string, member> Members;
+    unordered_map<string, vector<string> > Listing;  // Names in each directory.
+
+    void addMember(string name, const uint8_t * data, size_t size, long long mtime);
+    int indexTar(void);
+    int indexZip(void);
+    void findPrefix(void);
+    const member * find(const string & fileName) const;
+
+public:
+    assetArchive(void) : Map(NULL), MapSize(0) {}
+    ~assetArchive(void);
+
+    int open(const string & fileName);
+
+    bool read(const string & fileName, const uint8_t * & data, size_t & size) const;
+    int getStatus(const string & fileName, struct stat & info) const;
+    bool list(const string & directory, vector<string> & names) const;
+};
+
+extern assetArchive archiveFiles;
+
+#endif //!defined _ARCHIVE_H_INCLUDED_
@@ -0,0 +1,281 @@
+/**
+ * @file    assets.cpp
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ * Implementation for the assetIndex class.
+ */
+
+#include "cardgen.h"
+#include "assets.h"
+#include "archive.h"
+
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <fstream>
+
+
+/**
+ * @section Global variables.
+ *
+ */
+
+assetIndex assetFiles;
+
+
+/**
+ * @section main code.
+ *
+ */
+
+/**
+ * Check validity of the .png file.
+ *
+ * @param  buffer - raw bytes of the image file.
+ * @return true if valid, false otherwise.
+ */
+static bool isValidPNG(const char * const buffer)
+{
+    const uint8_t magic[] = { 0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A };
+
+    return memcmp(buffer, magic, sizeof(magic)) == 0;
+}
+
+
+/**
+ * Read the names of all the files in a directory into the index.
+ *
+ * @param  directory - directory to read, either empty or ending in '/'.
+ */
+void assetIndex::scan(const string & directory)
+{
+    Directories.insert(directory);
+
+    const entry unread = { false, false, 1, 1 };
+    vector<string> names;
+    archiveFiles.list(directory, names);
+    for (vector<string>::const_iterator it = names.begin(); it != names.end(); ++it)
+    {
+        Files.insert(make_pair(directory + *it, unread));
+    }
+
+    DIR * dir = opendir(directory.length() ? directory.c_str() : ".");
+    if (!dir)
+    {
+        return;
+    }
+
+    for (struct dirent * ent = readdir(dir); ent; ent = readdir(dir))
+    {
+        if (ent->d_name[0] == '.')
+            continue;
+
+        Files.insert(make_pair(directory + ent->d_name, unread));
+    }
+
+    closedir(dir);
+}
+
+
+/**
+ * Read the metadata file left by a previous run, if there is one.
+ *
+ */
+void assetIndex::loadMetadata(void)
+{
+    MetadataLoaded = true;
+    if (!metadataFilename.length())
+    {
+        return;
+    }
+
+    ifstream stream(metadataFilename);
+    string fileName;
+    metadata data;
+    while (getline(stream, fileName, '\t') && (stream >> data.MTime >> data.Size >> data.WidthPX >> data.HeightPX))
+    {
+        stream.ignore(1);
+        Metadata[fileName] = data;
+    }
+}
+
+
+/**
+ * Write the metadata file for the next run, but only if something changed.
+ * The file is written to a temporary file first and renamed, so concurrent
+ * runs never see a partial file.
+ *
+ */
+void assetIndex::saveMetadata(void)
+{
+    lock_guard<mutex> guard(Lock);
+    if ((!MetadataChanged) || (!metadataFilename.length()))
+    {
+        return;
+    }
+
+    const string temporary = metadataFilename + ".tmp";
+    ofstream stream(temporary);
+    for (unordered_map<string, metadata>::const_iterator it = Metadata.begin(); it != Metadata.end(); ++it)
+    {
+        const metadata & data = it->second;
+        stream << it->first << '\t' << data.MTime << ' ' << data.Size << ' ' << data.WidthPX << ' ' << data.HeightPX << endl;
+    }
+    stream.close();
+
+    if ((!stream) || (rename(temporary.c_str(), metadataFilename.c_str())))
+    {
+        remove(temporary.c_str());
+    }
+
+    MetadataChanged = false;
+}
+
+
+/**
+ * Read the size of the image from the header of a png file, unless the
+ * metadata file shows the file is unchanged since it was last read.
+ *
+ * @param  fileName - name of image file.
+ * @param  file - index entry to populate.
+ */
+void assetIndex::readHeader(const string & fileName, entry & file)
+{
+    file.HeaderRead = true;
+
+    struct stat status;
+    if (archiveFiles.getStatus(fileName, status))
+    {
+        return;
+    }
+
+    if (!MetadataLoaded)
+    {
+        loadMetadata();
+    }
+
+    const long long mtime = (long long)status.st_mtim.tv_sec * 1000000000LL + status.st_mtim.tv_nsec;
+    metadata & data = Metadata[fileName];
+    if ((data.MTime != mtime) || (data.Size != status.st_size))
+    {
+        char buffer[24];
+        bool valid;
+        const uint8_t * contents;
+        size_t size;
+        if (archiveFiles.read(fileName, contents, size))
+        {
+            valid = (size >= sizeof(buffer));
+            if (valid)
+                memcpy(buffer, contents, sizeof(buffer));
+        }
+        else
+        {
+            ifstream stream(fileName, ifstream::in|ifstream::binary);
+            valid = bool(stream.read(buffer, sizeof(buffer)));
+        }
+        valid = (valid) && (isValidPNG(buffer));
+
+        data.MTime = mtime;
+        data.Size = status.st_size;
+        data.WidthPX = valid ? htonl(*(uint32_t *)(buffer+16)) : 0;
+        data.HeightPX = valid ? htonl(*(uint32_t *)(buffer+20)) : 0;
+        MetadataChanged = true;
+    }
+
+    if ((data.WidthPX > 0) && (data.HeightPX > 0))
+    {
+        file.Valid = true;
+        file.WidthPX = data.WidthPX;
+        file.HeightPX = data.HeightPX;
+    }
+}
+
+
+/**
+ * Find a file in the index, reading its directory if that hasn't been done.
+ *
+ * @param  fileName - name of image file.
+ * @return the index entry, or NULL if the file doesn't exist.
+ */
+assetIndex::entry * assetIndex::find(const string & fileName)
+{
+    const string directory = fileName.substr(0, fileName.rfind('/') + 1);
+    if (Directories.find(directory) == Directories.end())
+    {
+        scan(directory);
+    }
+
+    unordered_map<string, entry>::iterator it = Files.find(fileName);
+
+    return (it == Files.end()) ? NULL : &it->second;
+}
+
+
+/**
+ * Check if a file exists in the asset directories.
+ *
+ * @param  fileName - name of image file.
+ * @return true if the file exists, false otherwise.
+ */
+bool assetIndex::exists(const string & fileName)
+{
+    lock_guard<mutex> guard(Lock);
+
+    return find(fileName) != NULL;
+}
+
+
+/**
+ * Get the size of the image in a png file.
+ *
+ * @param  fileName - name of image file.
+ * @param  width - width of the image in pixels.
+ * @param  height - height of the image in pixels.
+ * @return true if the file is a valid png file, false otherwise.
+ */
+bool assetIndex::getImageSize(const string & fileName, int & width, int & height)
+{
+    lock_guard<mutex> guard(Lock);
+
+    entry * file = find(fileName);
+    if (!file)
+    {
+        return false;
+    }
+
+    if (!file->HeaderRead)
+    {
+        readHeader(fileName, *file);
+    }
+
+    if (!file->Valid)
+    {
+        return false;
+    }
+
+    width = file->WidthPX;
+    height = file->HeightPX;
+
+    return true;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file    assets.h
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ * Interface for the assetIndex class.
+ */
+
+#if !defined _ASSETS_H_INCLUDED_
+#define _ASSETS_H_INCLUDED_
+
+#include <string>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace std;
+
+
+/**
+ * @section assetIndex class.
+ *
+ * Used to index the image files in the asset directories. Each directory is
+ * read once, when a file in it is first looked up, so probing for a file that
+ * doesn't exist never touches the file system. The png header of a file is
+ * read once, when its size is first needed, and the size is kept in a
+ * metadata file, saved at the end of a successful run, so later runs only
+ * need to stat the file. Lookups are serialised so that packs can be
+ * generated on several threads.
+ */
+class assetIndex
+{
+private:
+    struct entry
+    {
+        bool HeaderRead;
+        bool Valid;
+        int WidthPX;
+        int HeightPX;
+    };
+
+    struct metadata
+    {
+        long long MTime;
+        long long Size;
+        int WidthPX;
+        int HeightPX;
+    };
+
+    unordered_map<string, entry> Files;
+    unordered_set<string> Directories;
+
+    unordered_map<string, metadata> Metadata;
+    bool MetadataLoaded;
+    bool MetadataChanged;
+
+    mutex Lock;
+
+    void scan(const string & directory);
+    entry * find(const string & fileName);
+    void readHeader(const string & fileName, entry & file);
+
+    void loadMetadata(void);
+
+public:
+    assetIndex(void) : MetadataLoaded(false), MetadataChanged(false) {}
+
+    bool exists(const string & fileName);
+    bool getImageSize(const string & fileName, int & width, int & height);
+    void saveMetadata(void);
+
+};
+
+extern assetIndex assetFiles;
+
+#endif //!defined _ASSETS_H_INCLUDED_
+
@@ -0,0 +1,398 @@
+/**
+ * @file    atlas.cpp
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ * Texture atlas output. Packs the card images of each pack into one or more
+ * power of two sheets, with optional mip levels, and writes a manifest that
+ * gives the position of each card on the sheets.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <thread>
+#include "cardgen.h"
+#include "image.h"
+
+
+/**
+ * @section placement structure.
+ *
+ * Used to record where a card is drawn on the sheets.
+ */
+struct placement
+{
+    int sheet;
+    int x;
+    int y;
+    int w;
+    int h;
+
+    placement(void) : sheet(0), x(0), y(0), w(0), h(0) {}
+};
+
+
+/**
+ * @section byHeight structure.
+ *
+ * Used to sort the cards so that the tallest are packed first.
+ */
+struct byHeight
+{
+    const vector<placement> & cards;
+
+    byHeight(const vector<placement> & c) : cards(c) {}
+
+    bool operator()(size_t a, size_t b) const { return cards[a].h > cards[b].h; }
+};
+
+
+/**
+ * @section main code.
+ *
+ */
+
+/**
+ * Get the size of a card image from its render plan.
+ *
+ * @param  card - the card job.
+ * @param  w - returns the width of the card in pixels.
+ * @param  h - returns the height of the card in pixels.
+ * @return true if the size is known, false otherwise.
+ */
+static bool getCardSize(const job & card, int & w, int & h)
+{
+    w = h = 0;
+    for (renderPlan::const_iterator op = card.plan.begin(); op != card.plan.end(); ++op)
+    {
+        if ((op->type == drawOp::CANVAS) || (op->type == drawOp::RESIZE))
+        {
+            w = op->w;
+            h = op->h;
+        }
+    }
+
+    return (w > 0) && (h > 0);
+}
+
+
+/**
+ * Round a value up to a multiple of a power of two.
+ *
+ * @param  value - the value to round.
+ * @param  alignment - the power of two.
+ * @return the rounded value.
+ */
+static int align(int value, int alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+
+/**
+ * Pack the cards onto sheets of the given size, tallest first, filling each
+ * sheet row by row from the top left. Each card starts on a multiple of the
+ * gap, and is separated from its neighbours by at least the gap, so that no
+ * pixel of a mip level mixes two cards.
+ *
+ * @param  cards - the size of each card, updated with its position.
+ * @param  width - width of a sheet in pixels.
+ * @param  height - height of a sheet in pixels.
+ * @param  gap - space between the cards, a power of two.
+ * @return the number of sheets used, 0 if a card is larger than a sheet.
+ */
+static int packCards(vector<placement> & cards, int width, int height, int gap)
+{
+    vector<size_t> order;
+    for (size_t i = 0; i < cards.size(); ++i)
+    {
+        order.push_back(i);
+    }
+    stable_sort(order.begin(), order.end(), byHeight(cards));
+
+    int sheet = 0;
+    int x = 0;
+    int y = 0;
+    int rowHeight = 0;
+    for (vector<size_t>::const_iterator it = order.begin(); it != order.end(); ++it)
+    {
+        placement & card = cards[*it];
+        if ((card.w > width) || (card.h > height))
+            return 0;
+
+        if (x + card.w > width)
+        {
+            x = 0;
+            y = align(y + rowHeight + gap, gap);
+            rowHeight = 0;
+        }
+        if (y + card.h > height)
+        {
+            ++sheet;
+            x = 0;
+            y = 0;
+            rowHeight = 0;
+        }
+
+        card.sheet = sheet;
+        card.x = x;
+        card.y = y;
+        x = align(x + card.w + gap, gap);
+        rowHeight = max(rowHeight, card.h);
+    }
+
+    return sheet + 1;
+}
+
+
+/**
+ * Choose the sheet size and pack the cards. The smallest power of two sheet
+ * that holds every card is used, otherwise as many of the largest sheets as
+ * are needed.
+ *
+ * @param  cards - the size of each card, updated with its position.
+ * @param  gap - space between the cards, a power of two.
+ * @param  width - returns the width of a sheet in pixels.
+ * @param  height - returns the height of a sheet in pixels.
+ * @return the number of sheets used, 0 if a card is larger than a sheet.
+ */
+static int layoutSheets(vector<placement> & cards, int gap, int & width, int & height)
+{
+    width = height = 0;
+    for (int w = 1; w <= atlasSize; w *= 2)
+    {
+        for (int h = max(1, w / 2); (h <= w * 2) && (h <= atlasSize); h *= 2)
+        {
+            if ((width) && (size_t(w) * h >= size_t(width) * height))
+                continue;
+
+            vector<placement> packed(cards);
+            if (packCards(packed, w, h, gap) == 1)
+            {
+                width = w;
+                height = h;
+            }
+        }
+    }
+
+    if (!width)
+    {
+        width = height = atlasSize;
+    }
+
+    return packCards(cards, width, height, gap);
+}
+
+
+/**
+ * Quote a string for the manifest.
+ *
+ * @param  text - the string to quote.
+ * @return the quoted string.
+ */
+static string quote(const string & text)
+{
+    string quoted("\"");
+    for (string::const_iterator c = text.begin(); c != text.end(); ++c)
+    {
+        if ((*c == '"') || (*c == '\\'))
+            quoted += '\\';
+        quoted += *c;
+    }
+
+    return quoted + "\"";
+}
+
+
+/**
+ * Draw the sheets of a pack from its card images and write them, each
+ * followed by its mip levels.
+ *
+ * @param  path - output directory of the pack.
+ * @param  cards - the card jobs of the pack.
+ * @param  places - position of each card.
+ * @param  sheets - number of sheets.
+ * @param  width - width of a sheet in pixels.
+ * @param  height - height of a sheet in pixels.
+ * @return error value or 0 if no errors.
+ */
+static int writeSheets(const string & path, const vector<const job *> & cards, const vector<placement> & places, int sheets, int width, int height)
+{
+    const int threads = max(1U, thread::hardware_concurrency());
+
+    for (int s = 0; s < sheets; ++s)
+    {
+        image sheet(width, height);
+        for (size_t i = 0; i < cards.size(); ++i)
+        {
+            if (places[i].sheet != s)
+                continue;
+
+            image card;
+            if ((card.load(cards[i]->fileName)) || (card.getWidth() != places[i].w) || (card.getHeight() != places[i].h))
+            {
+                cerr << "Can't read card image " << cards[i]->fileName << " - aborting!" << endl;
+
+                return 1;
+            }
+            sheet.over(card, places[i].x, places[i].y);
+        }
+
+        for (int level = 0; level <= mipLevels; ++level)
+        {
+            if (level)
+            {
+                sheet = sheet.scale(max(1, sheet.getWidth() / 2), max(1, sheet.getHeight() / 2), BOX_FILTER);
+            }
+
+            const string fileName = path + "atlas" + to_string(s) + (level ? "-" + to_string(level) : string()) + ".png";
+            if (sheet.save(fileName, pngLevel, threads))
+            {
+                cerr << "Can't write image file " << fileName << " - aborting!" << endl;
+
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Write the manifest of a pack, which lists the sheets and their mip levels,
+ * and the position of each card in pixels and as texture coordinates.
+ *
+ * @param  path - output directory of the pack.
+ * @param  cards - the card jobs of the pack.
+ * @param  places - position of each card.
+ * @param  sheets - number of sheets.
+ * @param  width - width of a sheet in pixels.
+ * @param  height - height of a sheet in pixels.
+ * @return error value or 0 if no errors.
+ */
+static int writeManifest(const string & path, const vector<const job *> & cards, const vector<placement> & places, int sheets, int width, int height)
+{
+    const string fileName = path + "atlas.json";
+    ofstream file(fileName.c_str(), ofstream::out|ofstream::trunc);
+    if (!file)
+    {
+        cerr << "Can't create manifest " << fileName << " - aborting!" << endl;
+
+        return 1;
+    }
+
+    file << "{" << endl;
+    file << "  \"width\": " << width << "," << endl;
+    file << "  \"height\": " << height << "," << endl;
+    file << "  \"sheets\": [" << endl;
+    for (int s = 0; s < sheets; ++s)
+    {
+        file << "    { \"file\": " << quote("atlas" + to_string(s) + ".png") << ", \"mips\": [";
+        for (int level = 1; level <= mipLevels; ++level)
+        {
+            file << (level > 1 ? ", " : " ") << quote("atlas" + to_string(s) + "-" + to_string(level) + ".png");
+        }
+        file << (mipLevels ? " ] }" : "] }") << (s + 1 < sheets ? "," : "") << endl;
+    }
+    file << "  ]," << endl;
+
+    file << "  \"cards\": [" << endl;
+    file << setprecision(9);
+    for (size_t i = 0; i < cards.size(); ++i)
+    {
+        const placement & place = places[i];
+        const string & cardFile = cards[i]->fileName;
+        file << "    { \"name\": " << quote(cards[i]->name) << ", \"file\": " << quote(cardFile.substr(cardFile.rfind('/') + 1)) <<
+            ", \"sheet\": " << place.sheet << ", \"x\": " << place.x << ", \"y\": " << place.y <<
+            ", \"w\": " << place.w << ", \"h\": " << place.h <<
+            ", \"u0\": " << double(place.x) / width << ", \"v0\": " << double(place.y) / height <<
+            ", \"u1\": " << double(place.x + place.w) / width << ", \"v1\": " << double(place.y + place.h) / height <<
+            " }" << (i + 1 < cards.size() ? "," : "") << endl;
+    }
+    file << "  ]" << endl;
+    file << "}" << endl;
+
+    return file ? 0 : 1;
+}
+
+
+/**
+ * Pack the card images of each pack into texture atlas sheets, once the
+ * cards have been drawn, and write the manifest for each pack.
+ *
+ * @param  jobs - list of card jobs.
+ * @param  directories - list of output directories.
+ * @return error value or 0 if no errors.
+ */
+int buildAtlases(const vector<job> & jobs, const vector<string> & directories)
+{
+    const int gap = 1 << mipLevels;
+
+    for (vector<string>::const_iterator dir = directories.begin(); dir != directories.end(); ++dir)
+    {
+        const string path = string("cards/") + *dir + "/";
+
+//- Find the cards of the pack and their sizes.
+        vector<const job *> cards;
+        vector<placement> places;
+        for (vector<job>::const_iterator it = jobs.begin(); it != jobs.end(); ++it)
+        {
+            if (it->fileName.compare(0, path.length(), path) != 0)
+                continue;
+
+            placement place;
+            if (!getCardSize(*it, place.w, place.h))
+            {
+                cerr << "Can't find the size of " << it->fileName << " - aborting!" << endl;
+
+                return 1;
+            }
+            cards.push_back(&*it);
+            places.push_back(place);
+        }
+        if (cards.empty())
+            continue;
+
+//- Lay out the sheets, then draw them and write the manifest.
+        int width, height;
+        const int sheets = layoutSheets(places, gap, width, height);
+        if (!sheets)
+        {
+            cerr << "Cards in " << path << " are larger than the atlas - aborting!" << endl;
+
+            return 1;
+        }
+
+        if ((writeSheets(path, cards, places, sheets, width, height)) ||
+            (writeManifest(path, cards, places, sheets, width, height)))
+        {
+            return 1;
+        }
+
+        cout << "Atlas of " << cards.size() << " cards on " << sheets << " " << width << "x" << height << " sheet" << (sheets > 1 ? "s" : "") << " created in " << path << endl;
+    }
+
+    return 0;
+}
+
@@ -0,0 +1,266 @@
+/**
+ * @file    cache.cpp
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ * Content addressed card image cache. Each card is keyed on its drawing
+ * command and the contents of every image file it is drawn from, so an
+ * unchanged card can be copied from the cache instead of being drawn again.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <stdio.h>
+#include <unistd.h>
+#include "cardgen.h"
+#include "archive.h"
+
+
+/**
+ * @section Internal constants and variables.
+ *
+ */
+
+static const uint64_t fnvOffset = 0xCBF29CE484222325ULL;
+static const uint64_t fnvPrime  = 0x00000100000001B3ULL;
+
+static map<string, uint64_t> fileHashes;    // Content hash of each image file.
+static mutex hashLock;                      // Guards fileHashes.
+static atomic<unsigned> tempCount(0);       // Makes temporary file names unique.
+
+
+/**
+ * @section main code.
+ *
+ */
+
+/**
+ * Add a block of bytes to a 64-bit FNV-1a hash.
+ *
+ * @param  hash - the hash to update.
+ * @param  data - the bytes to add.
+ * @param  length - number of bytes.
+ * @return the updated hash.
+ */
+static uint64_t hashBytes(uint64_t hash, const char * data, size_t length)
+{
+    for (size_t i = 0; i < length; ++i)
+    {
+        hash ^= (uint8_t)data[i];
+        hash *= fnvPrime;
+    }
+
+    return hash;
+}
+
+
+/**
+ * Get the content hash of an image file, reading the file only on first use.
+ *
+ * @param  fileName - name of image file.
+ * @return the content hash.
+ */
+uint64_t hashFile(const string & fileName)
+{
+    {
+        lock_guard<mutex> guard(hashLock);
+        map<string, uint64_t>::const_iterator it = fileHashes.find(fileName);
+        if (it != fileHashes.end())
+        {
+            return it->second;
+        }
+    }
+
+    uint64_t hash = fnvOffset;
+    const uint8_t * data;
+    size_t size;
+    if (archiveFiles.read(fileName, data, size))
+    {
+        hash = hashBytes(hash, (const char *)data, size);
+    }
+    else
+    {
+        ifstream file(fileName, ifstream::in|ifstream::binary);
+        char buffer[65536];
+        while (file.read(buffer, sizeof(buffer)) || (file.gcount()))
+        {
+            hash = hashBytes(hash, buffer, file.gcount());
+        }
+    }
+
+    lock_guard<mutex> guard(hashLock);
+    fileHashes[fileName] = hash;
+
+    return hash;
+}
+
+
+/**
+ * Copy a file, replacing the destination.
+ *
+ * @param  from - name of the source file.
+ * @param  to - name of the destination file.
+ * @return error value or 0 if no errors.
+ */
+static int copyFile(const string & from, const string & to)
+{
+    ifstream source(from, ifstream::in|ifstream::binary);
+    if (!source)
+    {
+        return 1;
+    }
+
+    ofstream dest(to, ofstream::out|ofstream::binary|ofstream::trunc);
+    dest << source.rdbuf();
+
+    return dest ? 0 : 1;
+}
+
+
+/**
+ * Replace a file with a private copy of another. The copy is written to a
+ * temporary file that is then renamed over the old one, so card images and
+ * cache entries never share storage: a card image that is later overwritten
+ * in place can't change a cache entry, and a partly written copy is never
+ * seen under the final name.
+ *
+ * @param  from - name of the existing file.
+ * @param  to - name of the file to replace.
+ * @return error value or 0 if no errors.
+ */
+static int replaceFile(const string & from, const string & to)
+{
+    const string temp = to + "." + to_string(getpid()) + "." + to_string(++tempCount);
+    if ((copyFile(from, temp)) || (rename(temp.c_str(), to.c_str())))
+    {
+        unlink(temp.c_str());
+
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Generate the cache key for a card. The key covers the renderer and every
+ * setting that changes the bytes it writes, the render plan without the
+ * output file name, and the contents of each image file used by the card.
+ *
+ * @param  card - the card job.
+ * @return the cache key as a hex string.
+ */
+string getCacheKey(const job & card)
+{
+    const string renderer((renderImages ? "native " + filterName + " level " + to_string(pngLevel) + (sharedPalette ? " shared" : "") : "convert") +
+        " " + outputFormat);
+    renderPlan plan;
+    for (renderPlan::const_iterator op = card.plan.begin(); op != card.plan.end(); ++op)
+    {
+        if (op->type != drawOp::WRITE)
+            plan.push_back(*op);
+    }
+    const string draw = genConvertCommand(plan);
+
+    uint64_t hash = hashBytes(fnvOffset, renderer.c_str(), renderer.length() + 1);
+    hash = hashBytes(hash, draw.c_str(), draw.length() + 1);
+    for (vector<string>::const_iterator it = card.inputs.begin(); it != card.inputs.end(); ++it)
+    {
+        const uint64_t fileHash = hashFile(*it);
+        hash = hashBytes(hash, (const char *)&fileHash, sizeof(fileHash));
+    }
+
+    char key[17];
+    snprintf(key, sizeof(key), "%016llx", (unsigned long long)hash);
+
+    return string(key);
+}
+
+
+/**
+ * Make each cache key cover every card in the list. Used with a shared
+ * palette, where each card image depends on the colours of all the cards.
+ *
+ * @param  keys - the cache key of each card, updated in place.
+ */
+void shareCacheKeys(vector<string> & keys)
+{
+    uint64_t hash = fnvOffset;
+    for (vector<string>::const_iterator it = keys.begin(); it != keys.end(); ++it)
+    {
+        hash = hashBytes(hash, it->c_str(), it->length() + 1);
+    }
+
+    for (vector<string>::iterator it = keys.begin(); it != keys.end(); ++it)
+    {
+        char key[17];
+        snprintf(key, sizeof(key), "%016llx", (unsigned long long)hashBytes(hash, it->c_str(), it->length() + 1));
+        *it = string(key);
+    }
+}
+
+
+/**
+ * Get the cache entry file name for a key.
+ *
+ * @param  key - the cache key.
+ * @return the cache entry file name.
+ */
+static string getEntryName(const string & key)
+{
+    return cacheDirectory + "/" + key + "." + outputFormat;
+}
+
+
+/**
+ * Retrieve a card image from the cache.
+ *
+ * @param  key - the cache key of the card.
+ * @param  fileName - name of the card image file to write.
+ * @return true if the card was in the cache, false otherwise.
+ */
+bool fetchFromCache(const string & key, const string & fileName)
+{
+    const string entry = getEntryName(key);
+    if (access(entry.c_str(), R_OK))
+    {
+        return false;
+    }
+
+    return replaceFile(entry, fileName) == 0;
+}
+
+
+/**
+ * Store a newly drawn card image in the cache.
+ *
+ * @param  key - the cache key of the card.
+ * @param  fileName - name of the card image file.
+ * @return error value or 0 if no errors.
+ */
+int storeInCache(const string & key, const string & fileName)
+{
+    return replaceFile(fileName, getEntryName(key));
+}
+
@@ -24,6 +24,7 @@
  */
 
 #include "cardgen.h"
+#include "assets.h"
 #include <sys/stat.h>
 
 
@@ -32,50 +33,27 @@
  *
  */
 
-int cardWidth  = 380;
-int cardHeight = 532;
-string cardColour("white");
-
-info indexInfo(10.5, 8.07, 9.84);
-info cornerPipInfo(7.5, 8.07, 20.41);
-info standardPipInfo(18.0, 25.7, 18.65);
-info imagePipInfo(14.29, 12.63, 9.77);
-
-string indexDirectory("1");
-string pipDirectory("1");
-string faceDirectory("1");
-
 string scriptFilename("draw.sh");
 string refreshFilename("x_refresh.sh");
-string outputDirectory;
-
-bool keepAspectRatio = false;
-
-float cornerRadius = 3.76;
-int radius;
-int strokeWidth = 2;
-int borderOffset = 1;
-int outlineWidth;
-int outlineHeight;
-
-float boarderX = 14.54;
-float boarderY = 10.14;
-float originalImageWidth = 100 - (2 * boarderX);
-float originalImageHeight = 50 - boarderY;
-int originalWidthPX  = ROUND(originalImageWidth * cardWidth / 100);
-int originalHeightPX = ROUND(originalImageHeight * cardHeight / 100);
-
-float winPX;
-float winPY;
-
-float imageWidth;
-float imageHeight;
-int widthPX;
-int heightPX;
-int offsetX;
-int offsetY;
-float imageX;
-float imageY;
+string makeFilename;
+string batchFilename;
+string cacheDirectory("cards/.cache");
+string metadataFilename(".cardgen-meta");
+string pixelCacheFilename(".cardgen-pixels");
+string archiveFilename;
+string filterName("bilinear");
+
+bool renderImages = false;
+int jobCount = 0;
+bool useCache = false;
+bool useMagick = false;
+bool sharedPalette = false;
+int pngLevel = 6;
+string outputFormat("png");
+int atlasSize = 0;
+int mipLevels = 0;
+bool showStats = false;
+int imageCacheMB = 256;
 
 
 /**
@@ -88,22 +66,61 @@ float imageY;
 int main(int argc, char *argv[])
 {
 //- Get the command line parameters.
-    int ret = init(argc, argv);
+    deckConfig config;
+    int ret = init(argc, argv, config);
 
     if (ret < 0)
     {
         return 1;
     }
 
-//- If all is well, generate the script.
-    if (!ret)
+//- If all is well, generate the drawing commands for the pack, or packs.
+    if (ret)
     {
-        generateScript(argc, argv);
+        return 0;
+    }
+
+    vector<job> jobs;
+    vector<string> directories;
+    if (batchFilename.length())
+    {
+        if (generateBatch(argc, argv, jobs, directories))
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        generateJobs(config, jobs);
+        directories.push_back(config.outputDirectory);
+    }
+
+//- Either build the cards directly or generate the script.
+    if ((renderImages) || (jobCount))
+    {
+        if (buildDeck(jobs, directories))
+        {
+            return 1;
+        }
+    }
+    else if (makeFilename.length())
+    {
+        if (generateMakefile(argc, argv, jobs, directories))
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        generateScript(argc, argv, jobs, directories);
 
         // Ensure output scripts are executable.
         chmod(scriptFilename.c_str(), S_IRWXU|S_IRGRP|S_IXGRP|S_IROTH|S_IXOTH);
     }
 
+//- Remember the image sizes for the next run.
+    assetFiles.saveMetadata();
+
     return 0;
 }
 
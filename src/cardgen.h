@@ -27,7 +27,10 @@
 #define _CARDGEN_H_INCLUDED_
 
 #include <string>
+#include <vector>
 #include "desc.h"
+#include "deck.h"
+#include "plan.h"
 
 using namespace std;
 
@@ -41,54 +44,51 @@ using namespace std;
 
 
 /**
- * @section Global variables.
+ * @section job structure.
  *
+ * Used to capture the render plan for a single card.
  */
+struct job
+{
+    string comment;
+    string name;                // Name of the card, such as "Ace of Spades".
+    renderPlan plan;            // Steps that draw the card.
+    string fileName;
+    vector<string> inputs;      // Image files the card is drawn from.
+    size_t baseLength;          // Leading steps of the plan shared with other cards.
 
-extern int cardWidth;
-extern int cardHeight;
-extern string cardColour;
+    job(void) : baseLength(0) {}
+};
 
-extern info indexInfo;
-extern info cornerPipInfo;
-extern info standardPipInfo;
-extern info imagePipInfo;
 
-extern string indexDirectory;
-extern string pipDirectory;
-extern string faceDirectory;
+/**
+ * @section Global variables.
+ *
+ * These only control what is output and are set once from the command line.
+ * Everything that controls how the cards look is held in a deckConfig.
+ */
 
 extern string scriptFilename;
-extern string outputDirectory;
 extern string refreshFilename;
-
-extern bool keepAspectRatio;
-
-extern float cornerRadius;
-extern int radius;
-extern int strokeWidth;
-extern int borderOffset;
-extern int outlineWidth;
-extern int outlineHeight;
-
-extern float boarderX;
-extern float boarderY;
-extern float originalImageWidth;
-extern float originalImageHeight;
-extern int originalWidthPX;
-extern int originalHeightPX;
-
-extern float winPX;
-extern float winPY;
-
-extern float imageWidth;
-extern float imageHeight;
-extern int widthPX;
-extern int heightPX;
-extern int offsetX;
-extern int offsetY;
-extern float imageX;
-extern float imageY;
+extern string makeFilename;
+extern string batchFilename;
+extern string cacheDirectory;
+extern string metadataFilename;
+extern string pixelCacheFilename;
+extern string archiveFilename;
+extern string filterName;
+
+extern bool renderImages;
+extern int jobCount;
+extern bool useCache;
+extern bool useMagick;
+extern bool sharedPalette;
+extern int pngLevel;
+extern string outputFormat;
+extern int atlasSize;
+extern int mipLevels;
+extern bool showStats;
+extern int imageCacheMB;
 
 
 /**
@@ -96,9 +96,25 @@ extern float imageY;
  *
  */
 
-extern void recalculate(void);
-extern int init(int argc, char *argv[]);
-extern int generateScript(int argc, char *argv[]);
+extern int init(int argc, char *argv[], deckConfig & config);
+extern vector<string> splitOptions(const string & command);
+extern int initVariant(int argc, char *argv[], const vector<string> & options, deckConfig & config);
+extern int generateJobs(const deckConfig & config, vector<job> & jobs);
+extern int generateAssetJobs(const vector<job> & jobs, vector<job> & assetJobs);
+extern int generateBatch(int argc, char *argv[], vector<job> & jobs, vector<string> & directories);
+extern int generateScript(int argc, char *argv[], const vector<job> & jobs, const vector<string> & directories);
+extern string genMagickCommand(const vector<job> & jobs);
+extern int generateMakefile(int argc, char *argv[], const vector<job> & jobs, const vector<string> & directories);
+extern int renderJobs(const vector<job> & jobs);
+extern int executeJobs(const vector<job> & jobs, int workers);
+extern int makePath(const string & path);
+extern int buildDeck(const vector<job> & jobs, const vector<string> & directories);
+extern int buildAtlases(const vector<job> & jobs, const vector<string> & directories);
+extern uint64_t hashFile(const string & fileName);
+extern string getCacheKey(const job & card);
+extern void shareCacheKeys(vector<string> & keys);
+extern bool fetchFromCache(const string & key, const string & fileName);
+extern int storeInCache(const string & key, const string & fileName);
 
 #endif //!defined _CARDGEN_H_INCLUDED_
 
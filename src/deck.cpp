@@ -0,0 +1,87 @@
+/**
+ * @file    deck.cpp
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ * Implementation for the deckConfig and deckGeometry structures.
+ */
+
+#include "cardgen.h"
+#include "deck.h"
+
+
+/**
+ * Constructor. Sets the default settings.
+ *
+ */
+deckConfig::deckConfig(void)
+: cardWidth(380), cardHeight(532), cardColour("white"),
+  indexInfo(10.5, 8.07, 9.84),
+  cornerPipInfo(7.5, 8.07, 20.41),
+  standardPipInfo(18.0, 25.7, 18.65),
+  imagePipInfo(14.29, 12.63, 9.77),
+  indexDirectory("1"), pipDirectory("1"), faceDirectory("1"),
+  keepAspectRatio(false),
+  cornerRadius(3.76), strokeWidth(2), borderOffset(1),
+  boarderX(14.54), boarderY(10.14)
+{
+}
+
+
+/**
+ * Constructor. Calculates the derived values from the settings.
+ *
+ * @param  config - the pack settings.
+ */
+deckGeometry::deckGeometry(const deckConfig & config)
+{
+    const int cardWidth  = config.cardWidth;
+    const int cardHeight = config.cardHeight;
+
+//- Card outline values in pixels.
+    radius = ROUND(config.cornerRadius * cardHeight / 100);
+    outlineWidth = cardWidth-config.borderOffset-1;
+    outlineHeight = cardHeight-config.borderOffset-1;
+
+//- Face image values for the default settings, used to scale image pips.
+    const deckConfig defaults;
+    originalImageWidth  = 100 - (2 * defaults.boarderX);
+    originalImageHeight = 50 - defaults.boarderY;
+    originalWidthPX  = ROUND(originalImageWidth * defaults.cardWidth / 100);
+    originalHeightPX = ROUND(originalImageHeight * defaults.cardHeight / 100);
+
+//- Calculate viewport window size as percentages of the card size. In this
+//  context the viewport is the area of the card not occupied by the standard
+//  pip boarders.
+    winPX = (100.0F - (2.0F * config.standardPipInfo.getX()));
+    winPY = (100.0F - (2.0F * config.standardPipInfo.getY()));
+
+//- Card face image values in pixels.
+    imageWidth  = 100 - (2 * config.boarderX);
+    imageHeight = 50 - config.boarderY;
+    widthPX     = ROUND(imageWidth * cardWidth / 100);
+    heightPX    = ROUND(imageHeight * cardHeight / 100);
+    offsetX     = ROUND(config.boarderX * cardWidth / 100);
+    offsetY     = ROUND(config.boarderY * cardHeight / 100);
+
+    imageX      = 50;
+    imageY      = config.boarderY + (imageHeight / 2);
+}
+
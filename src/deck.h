@@ -0,0 +1,103 @@
+/**
+ * @file    deck.h
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ * Interface for the deckConfig and deckGeometry structures.
+ */
+
+#if !defined _DECK_H_INCLUDED_
+#define _DECK_H_INCLUDED_
+
+#include <string>
+#include "desc.h"
+
+using namespace std;
+
+
+/**
+ * @section deckConfig structure.
+ *
+ * Used to capture the settings that control how the cards in a pack look.
+ * The constructor sets the default values.
+ */
+struct deckConfig
+{
+    int cardWidth;
+    int cardHeight;
+    string cardColour;
+
+    info indexInfo;
+    info cornerPipInfo;
+    info standardPipInfo;
+    info imagePipInfo;
+
+    string indexDirectory;
+    string pipDirectory;
+    string faceDirectory;
+    string outputDirectory;
+
+    bool keepAspectRatio;
+
+    float cornerRadius;
+    int strokeWidth;
+    int borderOffset;
+
+    float boarderX;
+    float boarderY;
+
+    deckConfig(void);
+};
+
+
+/**
+ * @section deckGeometry structure.
+ *
+ * Used to capture the values derived from a deckConfig, as pixels or as
+ * percentages of the card size.
+ */
+struct deckGeometry
+{
+    int radius;
+    int outlineWidth;
+    int outlineHeight;
+
+    float originalImageWidth;
+    float originalImageHeight;
+    int originalWidthPX;
+    int originalHeightPX;
+
+    float winPX;
+    float winPY;
+
+    float imageWidth;
+    float imageHeight;
+    int widthPX;
+    int heightPX;
+    int offsetX;
+    int offsetY;
+    float imageX;
+    float imageY;
+
+    deckGeometry(const deckConfig & config);
+};
+
+#endif //!defined _DECK_H_INCLUDED_
+
@@ -25,10 +25,7 @@
 
 #include "cardgen.h"
 #include "desc.h"
-
-#include <arpa/inet.h>
-#include <sstream>
-#include <fstream>
+#include "assets.h"
 
 
 /**
@@ -43,26 +40,7 @@ void info::print(ostream &os) const
 
 
 /**
- * Check validity of the .png file.
- *
- * @param  buffer - raw bytes of the image file.
- * @return true if valid, false otherwise.
- */
-bool desc::isValidPNG(const char * const buffer)
-{
-    const uint8_t magic[] = { 0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A };
-    for (int i = 0; i < sizeof(magic); ++i)
-    {
-        if ((uint8_t)buffer[i] != magic[i])
-            return false;
-    }
-
-    return true;
-}
-
-
-/**
- * Read the size of the image in a png file and populate the class.
+ * Look up the size of the image in a png file and populate the class.
  *
  * @return error value or 0 if no errors.
  */
@@ -73,95 +51,76 @@ int desc::getImageSize(void)
     HeightPX = 1;
     AspectRatio = 1;
 
-//- Open the binary file.
-    ifstream file(FileName, ifstream::in|ifstream::binary);
-
-    if (!file.is_open())
+    if (!assetFiles.getImageSize(FileName, WidthPX, HeightPX))
     {
         return 1;
     }
 
-//- Success. Read header data.
-    char buffer[28];
-
-    file.read(buffer, 24);
-    if ((file) && (isValidPNG(buffer)))
-    {
-        FileFound = true;
-        WidthPX = htonl(*(uint32_t *)(buffer+16));
-        HeightPX = htonl(*(uint32_t *)(buffer+20));
-        AspectRatio = float(WidthPX) / HeightPX;
-    }
-
-    file.close();
+    FileFound = true;
+    AspectRatio = float(WidthPX) / HeightPX;
 
     return 0;
 }
 
 
 /**
- * Set up "DrawString"" for drawing the .png file with the correct size and position.
+ * Add the step for drawing the .png file with the correct size and position
+ * to a render plan.
  *
- * @return error value or 0 if no errors.
+ * @param  plan - the render plan of the card.
  */
- int desc::genDrawString(void)
+void desc::draw(renderPlan & plan) const
 {
     if ((Height == 0) || (Width == 0))
     {
-        DrawString = "";	// Don't draw anything here.
-
-        return 0;
+        return;     // Don't draw anything here.
     }
 
-    stringstream outputStream;
-    outputStream  << "\t-draw \"image over " << OriginX << ',' << OriginY << ' ' << ROUND(Width) << ',' << ROUND(Height) << " '" << FileName << "'\" \\" << endl;
-    DrawString = outputStream.str();
-
-    return 0;
+    plan.push_back(imageOverOp(OriginX, OriginY, ROUND(Width), ROUND(Height), FileName));
 }
 
 
 /**
  * Constructor.
  *
+ * @param  config - the deck configuration supplying the card size.
  * @param  H - Height of image as a percentage of card height.
  * @param  X - X value of centre of image as a percentage of card width.
  * @param  Y - Y value of centre of image as a percentage of card height.
  * @param  fileName - Name of image file.
  * @return true if valid, false otherwise.
  */
-desc::desc(float H, float X, float Y, const string & fileName)
-: FileName(fileName), FileFound(false)
+desc::desc(const deckConfig & config, float H, float X, float Y, const string & fileName)
+: CardWidth(config.cardWidth), CardHeight(config.cardHeight), FileName(fileName), FileFound(false)
 {
     getImageSize();
-    Height  = H * cardHeight / 100;
+    Height  = H * CardHeight / 100;
     Width   = Height * WidthPX / HeightPX;
-    CentreX = X * cardWidth / 100;
-    CentreY = Y * cardHeight / 100;
+    CentreX = X * CardWidth / 100;
+    CentreY = Y * CardHeight / 100;
     OriginX = ROUND(centre2OriginX(CentreX));
     OriginY = ROUND(centre2OriginY(CentreY));
-    genDrawString();
 }
 
 
 /**
  * Constructor.
  *
+ * @param  config - the deck configuration supplying the card size.
  * @param  I - Height and position of image as a percentage of card size.
  * @param  fileName - Name of image file.
  * @return true if valid, false otherwise.
  */
-desc::desc(info & I, const string & fileName)
-: FileName(fileName), FileFound(false)
+desc::desc(const deckConfig & config, const info & I, const string & fileName)
+: CardWidth(config.cardWidth), CardHeight(config.cardHeight), FileName(fileName), FileFound(false)
 {
     getImageSize();
-    Height  = I.getH() * cardHeight / 100;
+    Height  = I.getH() * CardHeight / 100;
     Width   = Height * WidthPX / HeightPX;
-    CentreX = I.getX() * cardWidth / 100;
-    CentreY = I.getY() * cardHeight / 100;
+    CentreX = I.getX() * CardWidth / 100;
+    CentreY = I.getY() * CardHeight / 100;
     OriginX = ROUND(centre2OriginX(CentreX));
     OriginY = ROUND(centre2OriginY(CentreY));
-    genDrawString();
 }
 
 
@@ -173,11 +132,10 @@ desc::desc(info & I, const string & fileName)
  */
 void desc::repos(float X, float Y)
 {
-    CentreX = X * cardWidth / 100;
-    CentreY = Y * cardHeight / 100;
+    CentreX = X * CardWidth / 100;
+    CentreY = Y * CardHeight / 100;
     OriginX = ROUND(centre2OriginX(CentreX));
     OriginY = ROUND(centre2OriginY(CentreY));
-    genDrawString();
 }
 
 
@@ -192,6 +150,5 @@ void desc::setFileName(const string & fileName)
     getImageSize();
     Width   = Height * WidthPX / HeightPX;
     OriginX = ROUND(centre2OriginX(CentreX));
-    genDrawString();
 }
 
@@ -28,9 +28,12 @@
 
 #include <iostream>
 #include <string>
+#include "plan.h"
 
 using namespace std;
 
+struct deckConfig;
+
 
 /**
  * @section info class.
@@ -48,16 +51,16 @@ private:
     bool ChangedY;
 
 public:
+    info(void) : H(0), X(0), Y(0), ChangedH(false), ChangedX(false), ChangedY(false) {}
     info(float h, float x, float y) : H(h), X(x), Y(y), ChangedH(false), ChangedX(false), ChangedY(false) {}
-    info(const info & a) : H(a.H), X(a.X), Y(a.Y), ChangedH(false), ChangedX(false), ChangedY(false) {}
 
-    float getH(void) { return H; }
-    float getX(void) { return X; }
-    float getY(void) { return Y; }
+    float getH(void) const { return H; }
+    float getX(void) const { return X; }
+    float getY(void) const { return Y; }
 
-    bool isChangedH(void) { return ChangedH; }
-    bool isChangedX(void) { return ChangedX; }
-    bool isChangedY(void) { return ChangedY; }
+    bool isChangedH(void) const { return ChangedH; }
+    bool isChangedX(void) const { return ChangedX; }
+    bool isChangedY(void) const { return ChangedY; }
 
     void setH(float v) { ChangedH = true; H = v; }
     void setX(float v) { ChangedX = true; X = v; }
@@ -79,11 +82,11 @@ protected:
 class desc
 {
 private:
-    bool isValidPNG(const char * const buffer);
     int getImageSize(void);
-    int genDrawString(void);
 
-    string DrawString;
+    int CardWidth;
+    int CardHeight;
+
     bool FileFound;
     int WidthPX;
     int HeightPX;
@@ -99,8 +102,8 @@ private:
     string FileName;
 
 public:
-    desc(float H, float X, float Y, const string & FN);
-    desc(info & I, const string & FN);
+    desc(const deckConfig & config, float H, float X, float Y, const string & FN);
+    desc(const deckConfig & config, const info & I, const string & FN);
     void repos(float X, float Y);
     void setFileName(const string & fileName);
     const string & getFileName(void) const { return FileName; }
@@ -115,7 +118,7 @@ public:
     float getAspectRatio(void) const { return AspectRatio; }
     int getOriginX(void) const { return OriginX; }
     int getOriginY(void) const { return OriginY; }
-    const string & draw(void) const { return DrawString; }
+    void draw(renderPlan & plan) const;
 
     float centre2OriginX(float centre) const { return centre - (Width/2); }
     float centre2OriginY(float centre) const { return centre - (Height/2); }
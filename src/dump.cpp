@@ -27,8 +27,14 @@
 #include <string>
 #include <sstream>
 #include <fstream>
+#include <map>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
 #include "cardgen.h"
 #include "desc.h"
+#include "assets.h"
 
 
 /**
@@ -50,17 +56,19 @@ static const char* cardNames[]  = { "Joker", "Ace", "2", "3", "4", "5", "6", "7"
  */
 
 /**
- * Generate the initial blank card string used as a template for each card.
+ * Generate the initial blank card steps used as a template for each card.
  *
- * @return the generated string.
+ * @param  config - the pack settings.
+ * @param  geometry - values derived from the pack settings.
+ * @return the generated steps.
  */
-static string genStartString(void)
+static renderPlan genStartPlan(const deckConfig & config, const deckGeometry & geometry)
 {
-    stringstream outputStream;
-    outputStream  << "convert -size " << cardWidth << "x" << cardHeight << " xc:transparent  \\" << endl;
-    outputStream  << "\t-fill '" << cardColour << "' -stroke black -strokewidth " << strokeWidth << " -draw 'roundRectangle " << borderOffset << ',' << borderOffset << ' ' << outlineWidth << ',' << outlineHeight << ' ' << radius << ',' << radius << "' \\" << endl;
+    renderPlan plan;
+    plan.push_back(canvasOp(config.cardWidth, config.cardHeight, "transparent"));
+    plan.push_back(roundRectOp(config.borderOffset, config.borderOffset, geometry.outlineWidth, geometry.outlineHeight, geometry.radius, config.cardColour, "black", config.strokeWidth));
 
-    return outputStream.str();
+    return plan;
 }
 
 
@@ -132,250 +140,307 @@ patterns[] = { AD(corners), AD(ace), AD(c2), AD(c3), AD(c4), AD(c5), AD(c6), AD(
 
 
 /**
- * Generate the string for drawing the pips on the card. This is a two pass
+ * Generate the steps for drawing the pips on the card. This is a two pass
  * process. The second pass is after the card image has been rotated.
  *
+ * @param  config - the pack settings.
+ * @param  geometry - values derived from the pack settings.
  * @param  rotate - Rotated on first pass.
  * @param  card - 1 to 13 (ace to king).
- * @param  fileName - name of image file for the pip.
- * @return the generated string.
+ * @param  pipD - Image descriptor of the pip.
+ * @param  plan - the render plan to add the steps to.
  */
-static string drawStandardPips(bool rotate, int card, desc & pipD)
+static void drawStandardPips(const deckConfig & config, const deckGeometry & geometry, bool rotate, int card, desc & pipD, renderPlan & plan)
 {
-    stringstream outputStream;
-
     for (int i = 0; i < patterns[card].length; ++i)
     {
         const int index = patterns[card].locations[i];
         if (getRotate(index) == rotate)
         {
-            const float offX = standardPipInfo.getX() + (getXOffset(index) * winPX);
-            const float offY = standardPipInfo.getY() + (getYOffset(index) * winPY);
+            const float offX = config.standardPipInfo.getX() + (getXOffset(index) * geometry.winPX);
+            const float offY = config.standardPipInfo.getY() + (getYOffset(index) * geometry.winPY);
 
             pipD.repos(offX, offY);
-            outputStream  << pipD.draw();
+            pipD.draw(plan);
         }
     }
+}
 
-    return outputStream.str();
+
+/**
+ * Add the image file of a descriptor to the list of files a card is drawn
+ * from, but only if the file exists and is not already listed.
+ *
+ * @param  inputs - list of image files used by the card.
+ * @param  d - Image descriptor.
+ */
+static void addInput(vector<string> & inputs, const desc & d)
+{
+    if ((d.isFileFound()) && (find(inputs.begin(), inputs.end(), d.getFileName()) == inputs.end()))
+    {
+        inputs.push_back(d.getFileName());
+    }
 }
 
 
 /**
- * Generate the string for drawing the image on the card. Usually used for the
+ * Generate the steps for drawing the image on the card. Usually used for the
  * court cards. Numerous internal variables need to be recalculated if the
  * aspect ratio of the image is to be maintained, otherwise the image is
  * stretched to fill the card. Note that this is done for each image because
  * the dimensions can vary.
  *
+ * @param  config - the pack settings.
+ * @param  geometry - values derived from the pack settings.
  * @param  faceD - Image descriptor.
  * @param  fileName - name of image file for the pip.
- * @return the generated string.
+ * @param  inputs - list of image files used by the card.
+ * @param  plan - the render plan to add the steps to.
  */
-static string drawImage(const desc & faceD, const string & fileName)
+static void drawImage(const deckConfig & config, const deckGeometry & geometry, const desc & faceD, const string & fileName, vector<string> & inputs, renderPlan & plan)
 {
-    stringstream outputStream;
-    int x = offsetX;
-    int y = offsetY;
-    int w = widthPX;
-    int h = heightPX;
+    int x = geometry.offsetX;
+    int y = geometry.offsetY;
+    int w = geometry.widthPX;
+    int h = geometry.heightPX;
     float scale = 1;
     float aspectRatio = 0.0;
 
     if (faceD.isLandscape())
     {
-        if (keepAspectRatio)
+        if (config.keepAspectRatio)
         {
-            aspectRatio = float(widthPX) / heightPX;
+            aspectRatio = float(geometry.widthPX) / geometry.heightPX;
             if (faceD.getAspectRatio() < aspectRatio)
             {
                 // Use heightPX to redefine view port size.
-                scale = (float)heightPX / faceD.getHeightPX();
+                scale = (float)geometry.heightPX / faceD.getHeightPX();
                 w = ROUND(scale * faceD.getWidthPX()) + 1;
-                x = (cardWidth - w)/2;
+                x = (config.cardWidth - w)/2;
             }
             else
             {
                 // Use widthPX to redefine view port size.
-                scale = (float)widthPX / faceD.getWidthPX();
+                scale = (float)geometry.widthPX / faceD.getWidthPX();
                 h = ROUND(scale * faceD.getHeightPX());
-                y = (cardHeight/2) - h;
+                y = (config.cardHeight/2) - h;
             }
         }
     }
     else
     {
-        h = 2*heightPX;
-        if (keepAspectRatio)
+        h = 2*geometry.heightPX;
+        if (config.keepAspectRatio)
         {
-            aspectRatio = (float)widthPX / (2*heightPX);
+            aspectRatio = (float)geometry.widthPX / (2*geometry.heightPX);
             if (faceD.getAspectRatio() < aspectRatio)
             {
                 // Use 2*heightPX to redefine view port size.
-                scale = (float)(heightPX * 2) / faceD.getHeightPX();
+                scale = (float)(geometry.heightPX * 2) / faceD.getHeightPX();
                 w = ROUND(scale * faceD.getWidthPX());
-                x = (cardWidth - w)/2;
+                x = (config.cardWidth - w)/2;
             }
             else
             {
                 // Use widthPX to redefine view port size.
-                scale = (float)widthPX / faceD.getWidthPX();
+                scale = (float)geometry.widthPX / faceD.getWidthPX();
                 h = ROUND(scale * faceD.getHeightPX());
-                y = (cardHeight - h)/2;
+                y = (config.cardHeight - h)/2;
             }
         }
     }
 
-    outputStream << "\t-draw \"image over " << x << ',' << y << ' ' << w << ',' << h << " '" << faceD.getFileName() << "'\" \\" << endl;
+    plan.push_back(imageOverOp(x, y, w, h, faceD.getFileName()));
+    addInput(inputs, faceD);
 
 //- Check if image pips are required.
-    if (imagePipInfo.getH())
+    if (config.imagePipInfo.getH())
     {
-        info scaledPip(imagePipInfo);
+        info scaledPip(config.imagePipInfo);
 
 //- Rescale image pips, but only if they haven't been manually altered.
-        if (!imagePipInfo.isChangedH())
+        if (!config.imagePipInfo.isChangedH())
         {
-            scale = (float)h / originalHeightPX;
+            scale = (float)h / geometry.originalHeightPX;
             if (!faceD.isLandscape())
             {
                 scale /= 2;
             }
-            scaledPip.setH(scale * imagePipInfo.getH());
+            scaledPip.setH(scale * config.imagePipInfo.getH());
         }
 
-        if (!imagePipInfo.isChangedX())
+        if (!config.imagePipInfo.isChangedX())
         {
-            scale = (float)w / originalWidthPX;
-            scaledPip.setX(scale * imagePipInfo.getX());
+            scale = (float)w / geometry.originalWidthPX;
+            scaledPip.setX(scale * config.imagePipInfo.getX());
         }
 
-        if (!imagePipInfo.isChangedY())
+        if (!config.imagePipInfo.isChangedY())
         {
-            scale = (float)h / originalHeightPX;
+            scale = (float)h / geometry.originalHeightPX;
             if (!faceD.isLandscape())
             {
                 scale /= 2;
             }
-            scaledPip.setY(scale * imagePipInfo.getY());
+            scaledPip.setY(scale * config.imagePipInfo.getY());
         }
 
 //- Pip Filename is only supplied for court cards if they need pips adding.
-        desc pipD(scaledPip, fileName);
+        desc pipD(config, scaledPip, fileName);
         if (pipD.isFileFound())
         {
-            outputStream << "\t-draw \"image over " << pipD.getOriginX()+x << ',' << pipD.getOriginY()+y << ' ' << ROUND(pipD.getWidth()) << ',' << ROUND(pipD.getHeight()) << " '" << fileName << "'\" \\" << endl;
-            outputStream << "\t-rotate 180 \\" << endl;
-            outputStream << "\t-draw \"image over " << pipD.getOriginX()+x << ',' << pipD.getOriginY()+y << ' ' << ROUND(pipD.getWidth()) << ',' << ROUND(pipD.getHeight()) << " '" << fileName << "'\" \\" << endl;
-            outputStream << "\t-rotate 180 \\" << endl;
+            addInput(inputs, pipD);
+            const drawOp pip = imageOverOp(pipD.getOriginX()+x, pipD.getOriginY()+y, ROUND(pipD.getWidth()), ROUND(pipD.getHeight()), fileName);
+            plan.push_back(pip);
+            plan.push_back(rotateOp());
+            plan.push_back(pip);
+            plan.push_back(rotateOp());
         }
     }
+}
+
 
-    return outputStream.str();
+/**
+ * Add a card to the job list. The render plan is completed by reducing the
+ * colours and writing the card image, then optimised. The steps shared with
+ * the base layer are moved to the start of the plan where possible.
+ *
+ * @param  config - the pack settings.
+ * @param  jobs - list of card jobs.
+ * @param  comment - description of the card.
+ * @param  name - name of the card.
+ * @param  fileName - name of card image file being generated.
+ * @param  draw - the steps that draw the card.
+ * @param  base - the optimised steps that draw the base layer of the card.
+ * @param  inputs - list of image files used by the card.
+ */
+static void addJob(const deckConfig & config, vector<job> & jobs, const string & comment, const string & name, const string & fileName, const renderPlan & draw, const renderPlan & base, const vector<string> & inputs)
+{
+    job card;
+    card.comment  = comment;
+    card.name     = name;
+    card.inputs   = inputs;
+    card.fileName = string("cards/") + config.outputDirectory + "/" + fileName + "." + outputFormat;
+
+    card.plan = draw;
+    card.plan.push_back(quantizeOp(256));
+    card.plan.push_back(writeOp(card.fileName));
+    optimisePlan(card.plan);
+    card.baseLength = hoistBase(card.plan, base);
+
+    jobs.push_back(card);
 }
 
 
 /**
  * ImageMagick Joker drawing routine.
  *
- * @param  file - output file stream.
+ * @param  config - the pack settings.
+ * @param  geometry - values derived from the pack settings.
+ * @param  jobs - list of card jobs.
+ * @param  comment - description of the card.
+ * @param  name - name of the card.
  * @param  fileName - name of joker image file being generated.
  */
-static void drawImageMagickJoker(ofstream & file, const string & fileName)
+static void drawImageMagickJoker(const deckConfig & config, const deckGeometry & geometry, vector<job> & jobs, const string & comment, const string & name, const string & fileName)
 {
-    string startString = genStartString();
-
     string faceFile = string("boneyard/ImageMagick_logo.svg.png");
-    desc faceD(95, 50, 50, faceFile);
+    desc faceD(config, 95, 50, 50, faceFile);
 
     string headerFile = string("boneyard/ImageMagickUsage.png");
-    desc headerD(4, 50, 10, headerFile);
+    desc headerD(config, 4, 50, 10, headerFile);
     string footerFile = string("boneyard/ImageMagickURL.png");
-    desc footerD(3, 50, 90, footerFile);
-
-    file << startString;
-    file << drawImage(faceD, "");
-    file << headerD.draw();
-    file << footerD.draw();
-    file << "\t+dither -colors 256 \\" << endl;
-    file << "\tcards/" << outputDirectory << "/" << fileName << ".png" << endl;
-    file << endl;
+    desc footerD(config, 3, 50, 90, footerFile);
+
+    vector<string> inputs;
+    renderPlan draw = genStartPlan(config, geometry);
+    drawImage(config, geometry, faceD, "", inputs, draw);
+    headerD.draw(draw);
+    footerD.draw(draw);
+    addInput(inputs, headerD);
+    addInput(inputs, footerD);
+
+    addJob(config, jobs, comment, name, fileName, draw, genStartPlan(config, geometry), inputs);
 }
 
 
 /**
  * Default Joker drawing routine.
  *
- * @param  file - output file stream.
+ * @param  config - the pack settings.
+ * @param  geometry - values derived from the pack settings.
+ * @param  jobs - list of card jobs.
+ * @param  comment - description of the card.
+ * @param  name - name of the card.
  * @param  fileName - name of joker image file being generated.
  * @param  suit - index of suit for the joker being generated.
  */
-static void drawDefaultJoker(ofstream & file, const string & fileName, int suit)
+static void drawDefaultJoker(const deckConfig & config, const deckGeometry & geometry, vector<job> & jobs, const string & comment, const string & name, const string & fileName, int suit)
 {
-    string startString = genStartString();
-
     string faceFile = string("boneyard/Back.png");
-    desc faceD(95, 50, 50, faceFile);
+    desc faceD(config, 95, 50, 50, faceFile);
 
-    startString = genStartString();
-    file << startString;
+    vector<string> inputs;
+    renderPlan draw = genStartPlan(config, geometry);
 
     // Draw "Joker" indices if provided.
-    string indexFile = string("indices/") + indexDirectory + "/" + string(suits[suit]) + "Joker.png";
-    desc indexD(indexInfo, indexFile);
+    string indexFile = string("indices/") + config.indexDirectory + "/" + string(suits[suit]) + "Joker.png";
+    desc indexD(config, config.indexInfo, indexFile);
     if (indexD.isFileFound())
     {
-        file << indexD.draw();
-        file << "\t-rotate 180 \\" << endl;
-        file << indexD.draw();
+        indexD.draw(draw);
+        draw.push_back(rotateOp());
+        indexD.draw(draw);
+        addInput(inputs, indexD);
     }
 
-    file << drawImage(faceD, "");
-    file << "\t+dither -colors 256 \\" << endl;
-    file << "\tcards/" << outputDirectory << "/" << fileName << ".png" << endl;
-    file << endl;
+    drawImage(config, geometry, faceD, "", inputs, draw);
+
+    addJob(config, jobs, comment, name, fileName, draw, genStartPlan(config, geometry), inputs);
 }
 
 
 /**
  * Joker drawing routine - a bit messy, but gets the job done.
  *
+ * @param  config - the pack settings.
+ * @param  geometry - values derived from the pack settings.
  * @param  fails - default joker image output count.
- * @param  file - output file stream.
+ * @param  jobs - list of card jobs.
  * @param  suit - index of suit for the joker being generated.
  * @return 0 if joker image found and used, 1 if default joker created.
  */
-static int drawJoker(int fails, ofstream & file, int suit)
+static int drawJoker(const deckConfig & config, const deckGeometry & geometry, int fails, vector<job> & jobs, int suit)
 {
-    file << "# Draw the " << suitNames[suit] << " " << cardNames[0] << " as file " << suits[suit] << cardNames[0] << ".png" << endl;
-
     string fileName = string(suits[suit]) + cardNames[0];
-    string faceFile = string("faces/") + faceDirectory + "/" + fileName + ".png";
-    desc faceD(95, 50, 50, faceFile);
+    string name = string(suitNames[suit]) + " " + cardNames[0];
+    string comment = string("Draw the ") + name + " as file " + fileName + "." + outputFormat;
 
-    string indexFile = string("indices/") + indexDirectory + "/" + fileName + ".png";
-    desc indexD(indexInfo, indexFile);
+    string faceFile = string("faces/") + config.faceDirectory + "/" + fileName + ".png";
+    desc faceD(config, 95, 50, 50, faceFile);
+
+    string indexFile = string("indices/") + config.indexDirectory + "/" + fileName + ".png";
+    desc indexD(config, config.indexInfo, indexFile);
 
     if ((indexD.isFileFound()) || (faceD.isFileFound()))
     {
-        string startString = genStartString();
-        file << startString;
+        vector<string> inputs;
+        renderPlan draw = genStartPlan(config, geometry);
 
         if (indexD.isFileFound())
         {
-            file << indexD.draw();          // Draw index.
-            file << "\t-rotate 180 \\" << endl;
-            file << indexD.draw();          // Draw index.
+            indexD.draw(draw);          // Draw index.
+            draw.push_back(rotateOp());
+            indexD.draw(draw);          // Draw index.
+            addInput(inputs, indexD);
         }
 
         if (faceD.isFileFound())
         {
-            file << drawImage(faceD, "");
+            drawImage(config, geometry, faceD, "", inputs, draw);
         }
 
-        file << "\t+dither -colors 256 \\" << endl;
-        file << "\tcards/" << outputDirectory << "/" << fileName << ".png" << endl;
-        file << endl;
+        addJob(config, jobs, comment, name, fileName, draw, genStartPlan(config, geometry), inputs);
 
         return 0;
     }
@@ -385,11 +450,11 @@ static int drawJoker(int fails, ofstream & file, int suit)
     {
     case 0:
     case 2:
-        drawImageMagickJoker(file, fileName);
+        drawImageMagickJoker(config, geometry, jobs, comment, name, fileName);
         break;
 
     default:
-        drawDefaultJoker(file, fileName, suit);
+        drawDefaultJoker(config, geometry, jobs, comment, name, fileName, suit);
         break;
     }
 
@@ -398,63 +463,51 @@ static int drawJoker(int fails, ofstream & file, int suit)
 
 
 /**
- * The bulk of the script generation work.
+ * Mark the image steps that draw an asset at a size used more than once in
+ * the pack, so that the asset is scaled once and every step draws the scaled
+ * copy instead of scaling the asset again.
  *
- * @param  argc - command line argument count.
- * @param  argv - command line argument vector.
- * @return error value or 0 if no errors.
+ * @param  first - the first card job of the pack.
+ * @param  last - the card job after the last card job of the pack.
  */
-int generateScript(int argc, char *argv[])
+static void shareScaledAssets(vector<job>::iterator first, vector<job>::iterator last)
 {
-    ofstream file(scriptFilename.c_str());
+    map<string, int> uses;
 
-//- Open the script file for writing.
-    if (!file)
+    for (int pass = 0; pass < 2; ++pass)
     {
-        cerr << "Can't open output file " << scriptFilename << " - aborting!" << endl;
-
-        return 1;
-    }
-
-//- Generate the initial preamble of the script.
-    file << "#!/bin/sh" << endl;
-    file << endl;
-    file << "# This file was generated as \"" << scriptFilename << "\" using the following command:" << endl;
-    file << "#" << endl;
-    file << "#  ";
-    for (int i = 0; i < argc; ++i)
-    {
-        file << argv[i] << ' ';
+        for (vector<job>::iterator it = first; it != last; ++it)
+        {
+            for (renderPlan::iterator op = it->plan.begin(); op != it->plan.end(); ++op)
+            {
+                if ((op->type != drawOp::IMAGE_OVER) || (op->w == 0) || (op->h == 0) || (!assetFiles.exists(op->file)))
+                    continue;
+
+                const string key = op->file + " " + to_string(op->w) + "x" + to_string(op->h) + (op->rotated ? " r" : "");
+                if (pass == 0)
+                    ++uses[key];
+                else
+                    op->prepared = (uses[key] > 1);
+            }
+        }
     }
-    file << endl;
-    file << "#" << endl;
-    file << endl;
-    file << "# Make the directories."  << endl;
-    file << "mkdir -p cards"  << endl;
-    file << "mkdir -p cards/" << outputDirectory << endl;
+}
 
-    file << endl;
-    file << "# Generate the refresh script."  << endl;
-    file << "cat <<EOM >cards/" << outputDirectory  << "/" << refreshFilename << endl;
-    file << "#!/bin/sh" << endl;
-    file << endl;
-    file << "# This file was generated using the following " << argv[0] << " command." << endl;
-    file << "#" << endl;
-    file << "cd ../../" << endl;
-    for (int i = 0; i < argc; ++i)
-    {
-        file << argv[i] << ' ';
-    }
-    file << endl;
-    file << "./" << scriptFilename << endl;
-    file << "EOM" << endl;
-    file << endl;
-    file << "chmod +x cards/" << outputDirectory	<< "/" << refreshFilename << endl;
-    file << endl;
 
+/**
+ * Generate the drawing commands for every card in the pack.
+ *
+ * @param  config - the pack settings.
+ * @param  jobs - list of card jobs to populate.
+ * @return error value or 0 if no errors.
+ */
+int generateJobs(const deckConfig & config, vector<job> & jobs)
+{
+    const deckGeometry geometry(config);
+    const size_t first = jobs.size();
 
-//- Initial blank card string used as a template for each card.
-    string startString = genStartString();
+//- Initial blank card steps used as a template for each card.
+    const renderPlan startPlan = genStartPlan(config, geometry);
     string suit;
     string card;
 
@@ -463,94 +516,490 @@ int generateScript(int argc, char *argv[])
     {
         suit    = string(suits[s]);
 
-        string pipFile = string("pips/") + pipDirectory + "/" + suit + "S.png";     // Try small pip file first.
-        desc pipD(cornerPipInfo, pipFile);
+        string pipFile = string("pips/") + config.pipDirectory + "/" + suit + "S.png";     // Try small pip file first.
+        desc pipD(config, config.cornerPipInfo, pipFile);
         if (!pipD.isFileFound())
         {
             // Small pip file not found, so use standard pip file.
-            pipFile = string("pips/") + pipDirectory + "/" + suit + ".png";
+            pipFile = string("pips/") + config.pipDirectory + "/" + suit + ".png";
             pipD.setFileName(pipFile);
         }
 
         // Generate the playing cards in the current suit.
-        pipFile = string("pips/") + pipDirectory + "/" + suit + ".png";             // Use standard pip file.
-        desc standardPipD(standardPipInfo, pipFile);
+        pipFile = string("pips/") + config.pipDirectory + "/" + suit + ".png";             // Use standard pip file.
+        desc standardPipD(config, config.standardPipInfo, pipFile);
+
+        // The blank card and the corner pips are shared by every card in the suit.
+        renderPlan base(startPlan);
+        pipD.draw(base);
+        base.push_back(rotateOp());
+        pipD.draw(base);
+        optimisePlan(base);
+
         for (int c = 1; c < ELEMENTS(cards); ++c)
         {
             // Set up the variables.
             card = string(cards[c]);
 
-            string indexFile = string("indices/") + indexDirectory + "/" + suit + card + ".png";
-            desc indexD(indexInfo, indexFile);
+            string indexFile = string("indices/") + config.indexDirectory + "/" + suit + card + ".png";
+            desc indexD(config, config.indexInfo, indexFile);
             if (!indexD.isFileFound())
             {
                 // indexInfo for suit file not found, so use alternate index file.
-                indexFile = string("indices/") + indexDirectory + "/" + string(alts[s]) + card + ".png";
+                indexFile = string("indices/") + config.indexDirectory + "/" + string(alts[s]) + card + ".png";
                 indexD.setFileName(indexFile);
             }
 
-            string faceFile = string("faces/") + faceDirectory + "/" + suit + card + ".png";
-            desc faceD(imageHeight, imageX, imageY, faceFile);
+            string faceFile = string("faces/") + config.faceDirectory + "/" + suit + card + ".png";
+            desc faceD(config, geometry.imageHeight, geometry.imageX, geometry.imageY, faceFile);
 
-            string drawFace;
+            renderPlan drawFace;
+            vector<string> inputs;
 
             if (faceD.useStandardPips())
             {
                 // The face directory does not have the needed image file, use standard pips.
-                drawFace = drawStandardPips(true, c, standardPipD);
+                drawStandardPips(config, geometry, true, c, standardPipD, drawFace);
+                addInput(inputs, standardPipD);
             }
             else
             {
                 // The face directory does have the needed image file, so use it.
                 // Note, we only pass the pipfile name for the court cards (c > 10).
-                drawFace = drawImage(faceD, c > 10 ? pipFile : "");
+                drawImage(config, geometry, faceD, c > 10 ? pipFile : "", inputs, drawFace);
             }
 
 
-            // Write to output file.
-            file << "# Draw the " << cardNames[c] << " of " << suitNames[s] << " as file " << suit << card << ".png." << endl;
-            file << startString;
+            // Build the render plan.
+            renderPlan draw(startPlan);
 
             if ((faceD.useStandardPips()) || (faceD.isFileFound() && faceD.isLandscape()))
             {
-                file << drawFace;			// Draw either half of the pips or one of the landscape images.
+                draw.insert(draw.end(), drawFace.begin(), drawFace.end());			// Draw either half of the pips or one of the landscape images.
             }
-            file << pipD.draw();			// Draw corner pip.
-            file << indexD.draw();			// Draw index.
+            pipD.draw(draw);			// Draw corner pip.
+            indexD.draw(draw);			// Draw index.
 
-            file << "\t-rotate 180 \\" << endl;
+            draw.push_back(rotateOp());
 
             if (faceD.useStandardPips())
             {
-                drawFace = drawStandardPips(false, c, standardPipD);
+                drawFace.clear();
+                drawStandardPips(config, geometry, false, c, standardPipD, drawFace);
             }
-            file << drawFace;				// Draw either the rest of the pips or the needed image.
-            file << pipD.draw();			// Draw corner pip.
-            file << indexD.draw();			// Draw index.
-
-            file << "\t+dither -colors 256 \\" << endl;
-            file << "\tcards/" << outputDirectory << "/" << suit << card << ".png" << endl;
-
-            file << endl;
+            draw.insert(draw.end(), drawFace.begin(), drawFace.end());				// Draw either the rest of the pips or the needed image.
+            pipD.draw(draw);			// Draw corner pip.
+            indexD.draw(draw);			// Draw index.
+            addInput(inputs, pipD);
+            addInput(inputs, indexD);
+
+            string name = string(cardNames[c]) + " of " + suitNames[s];
+            string comment = string("Draw the ") + name + " as file " + suit + card + "." + outputFormat + ".";
+            addJob(config, jobs, comment, name, suit + card, draw, base, inputs);
         }
     }
 
 
 //- Add the Jokers using narrower boarders.
-    boarderX = 7;
-    boarderY = 5;
-    indexInfo.setH(30.0);
-    indexInfo.setY(20.0);
-    recalculate();
+    deckConfig jokerConfig(config);
+    jokerConfig.boarderX = 7;
+    jokerConfig.boarderY = 5;
+    jokerConfig.indexInfo.setH(30.0);
+    jokerConfig.indexInfo.setY(20.0);
+    const deckGeometry jokerGeometry(jokerConfig);
 
     int fails = 0;
     for (int s = 0; s < ELEMENTS(suits); ++s)
     {
-        fails += drawJoker(fails, file, s);
+        fails += drawJoker(jokerConfig, jokerGeometry, fails, jobs, s);
+    }
+
+//- Scale each asset that is drawn at the same size more than once only once.
+    shareScaledAssets(jobs.begin() + first, jobs.end());
+
+    return 0;
+}
+
+
+/**
+ * Generate the drawing commands for the pack variants, sharing them out
+ * between worker threads. Each variant has its own settings and job list, so
+ * the only shared state is the next variant to be generated.
+ *
+ * @param  configs - the settings of each pack variant.
+ * @param  variantJobs - list of card jobs to populate for each variant.
+ * @param  next - index of the next variant to be generated.
+ */
+static void generateVariants(const vector<deckConfig> & configs, vector< vector<job> > & variantJobs, atomic<size_t> & next)
+{
+    for (size_t i = next++; i < configs.size(); i = next++)
+    {
+        generateJobs(configs[i], variantJobs[i]);
+    }
+}
+
+
+/**
+ * Generate the drawing commands for every card in each of the pack variants
+ * listed in the batch manifest. Each line of the manifest holds the options
+ * for one variant, which are applied on top of the command line options.
+ * Blank lines and lines starting with '#' are ignored. The manifest is read
+ * first, then the variants are generated concurrently, using the '-j' job
+ * count if given, and their jobs are added in manifest order.
+ *
+ * @param  argc - command line argument count.
+ * @param  argv - command line argument vector.
+ * @param  jobs - list of card jobs to populate.
+ * @param  directories - list of output directories to populate.
+ * @return error value or 0 if no errors.
+ */
+int generateBatch(int argc, char *argv[], vector<job> & jobs, vector<string> & directories)
+{
+    ifstream manifest(batchFilename.c_str());
+
+    if (!manifest)
+    {
+        cerr << "Can't open batch manifest " << batchFilename << " - aborting!" << endl;
+
+        return 1;
+    }
+
+//- Read the settings for each variant.
+    vector< vector<string> > variants;
+    vector<int> numbers;
+    string line;
+    for (int number = 1; getline(manifest, line); ++number)
+    {
+        const vector<string> options = splitOptions(line);
+        if ((options.empty()) || (options[0][0] == '#'))
+            continue;
+
+        variants.push_back(options);
+        numbers.push_back(number);
+    }
+
+    vector<deckConfig> configs(variants.size());
+    for (size_t i = 0; i < variants.size(); ++i)
+    {
+        if (initVariant(argc, argv, variants[i], configs[i]))
+        {
+            cerr << "Invalid options on line " << numbers[i] << " of " << batchFilename << " - aborting!" << endl;
+
+            return 1;
+        }
+
+        const string & outputDirectory = configs[i].outputDirectory;
+        if (find(directories.begin(), directories.end(), outputDirectory) != directories.end())
+        {
+            cerr << "Output directory " << outputDirectory << " is used more than once in " << batchFilename << " - aborting!" << endl;
+
+            return 1;
+        }
+
+        directories.push_back(outputDirectory);
+    }
+
+//- Generate the variants, on as many threads as '-j' asks for, or one per
+//  CPU without it.
+    vector< vector<job> > variantJobs(configs.size());
+    atomic<size_t> next(0);
+    const size_t threads = jobCount ? jobCount : max(1U, thread::hardware_concurrency());
+    const size_t count = min<size_t>(configs.size(), threads);
+    vector<thread> workers;
+    for (size_t i = 1; i < count; ++i)
+    {
+        workers.push_back(thread(generateVariants, cref(configs), ref(variantJobs), ref(next)));
+    }
+    generateVariants(configs, variantJobs, next);
+    for (vector<thread>::iterator it = workers.begin(); it != workers.end(); ++it)
+    {
+        it->join();
+    }
+
+    for (vector< vector<job> >::const_iterator it = variantJobs.begin(); it != variantJobs.end(); ++it)
+    {
+        jobs.insert(jobs.end(), it->begin(), it->end());
     }
 
-    file << "echo Output created in cards/" << outputDirectory << "/" << endl;
+    return 0;
+}
+
+
+/**
+ * Generate the jobs that prepare the scaled and rotated assets needed to draw
+ * the cards with 'convert'. Each asset is scaled and rotated once, however
+ * many cards use it.
+ *
+ * @param  jobs - list of card jobs.
+ * @param  assetJobs - list of asset jobs to populate.
+ * @return error value or 0 if no errors.
+ */
+int generateAssetJobs(const vector<job> & jobs, vector<job> & assetJobs)
+{
+    vector<string> files;
+
+    for (vector<job>::const_iterator it = jobs.begin(); it != jobs.end(); ++it)
+    {
+        for (renderPlan::const_iterator op = it->plan.begin(); op != it->plan.end(); ++op)
+        {
+            if ((op->type != drawOp::IMAGE_OVER) || ((!op->rotated) && (!op->prepared)))
+                continue;
+
+            // A missing asset is reported when the card is drawn.
+            if (!assetFiles.exists(op->file))
+                continue;
+
+            const string fileName = getPreparedName(*op);
+            if (find(files.begin(), files.end(), fileName) != files.end())
+                continue;
+
+            files.push_back(fileName);
+
+            job asset;
+            asset.fileName = fileName;
+            asset.inputs.push_back(op->file);
+            asset.plan.push_back(loadOp(op->file));
+            if (op->prepared)
+            {
+                asset.comment = string("Scale ") + op->file + (op->rotated ? ", rotate it" : "") + " and save as file " + fileName + ".";
+                asset.plan.push_back(resizeOp(op->w, op->h));
+            }
+            else
+            {
+                asset.comment = string("Rotate ") + op->file + " as file " + fileName + ".";
+            }
+            if (op->rotated)
+            {
+                asset.plan.push_back(rotateOp());
+            }
+            asset.plan.push_back(writeOp(fileName));
+
+            assetJobs.push_back(asset);
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * The bulk of the script generation work.
+ *
+ * @param  argc - command line argument count.
+ * @param  argv - command line argument vector.
+ * @param  jobs - list of card jobs.
+ * @param  directories - list of output directories.
+ * @return error value or 0 if no errors.
+ */
+int generateScript(int argc, char *argv[], const vector<job> & jobs, const vector<string> & directories)
+{
+    // A single 'magick' process rotates the assets itself.
+    vector<job> assetJobs;
+    if (!useMagick)
+    {
+        generateAssetJobs(jobs, assetJobs);
+    }
+
+    ofstream file(scriptFilename.c_str());
+
+//- Open the script file for writing.
+    if (!file)
+    {
+        cerr << "Can't open output file " << scriptFilename << " - aborting!" << endl;
+
+        return 1;
+    }
+
+//- Generate the initial preamble of the script.
+    file << "#!/bin/sh" << endl;
+    file << endl;
+    file << "# This file was generated as \"" << scriptFilename << "\" using the following command:" << endl;
+    file << "#" << endl;
+    file << "#  ";
+    for (int i = 0; i < argc; ++i)
+    {
+        file << argv[i] << ' ';
+    }
+    file << endl;
+    file << "#" << endl;
+    file << endl;
+    file << "# Make the directories."  << endl;
+    file << "mkdir -p cards"  << endl;
+    for (vector<string>::const_iterator dir = directories.begin(); dir != directories.end(); ++dir)
+    {
+        file << "mkdir -p cards/" << *dir << endl;
+    }
+    vector<string> assetDirectories;
+    for (vector<job>::const_iterator it = assetJobs.begin(); it != assetJobs.end(); ++it)
+    {
+        const string dir = it->fileName.substr(0, it->fileName.rfind('/'));
+        if (find(assetDirectories.begin(), assetDirectories.end(), dir) == assetDirectories.end())
+        {
+            assetDirectories.push_back(dir);
+            file << "mkdir -p " << dir << endl;
+        }
+    }
+
+    for (vector<string>::const_iterator dir = directories.begin(); dir != directories.end(); ++dir)
+    {
+        file << endl;
+        file << "# Generate the refresh script."  << endl;
+        file << "cat <<EOM >cards/" << *dir  << "/" << refreshFilename << endl;
+        file << "#!/bin/sh" << endl;
+        file << endl;
+        file << "# This file was generated using the following " << argv[0] << " command." << endl;
+        file << "#" << endl;
+        file << "cd ../../" << endl;
+        for (int i = 0; i < argc; ++i)
+        {
+            file << argv[i] << ' ';
+        }
+        file << endl;
+        file << "./" << scriptFilename << endl;
+        file << "EOM" << endl;
+        file << endl;
+        file << "chmod +x cards/" << *dir	<< "/" << refreshFilename << endl;
+    }
+    file << endl;
+
+
+//- Prepare the scaled and rotated assets, then generate all the playing cards.
+    for (vector<job>::const_iterator it = assetJobs.begin(); it != assetJobs.end(); ++it)
+    {
+        file << "# " << it->comment << endl;
+        file << genConvertCommand(it->plan);
+        file << endl;
+    }
+
+    if (useMagick)
+    {
+        file << "# Draw every card with a single magick process." << endl;
+        file << genMagickCommand(jobs);
+        file << endl;
+    }
+    else
+    {
+        for (vector<job>::const_iterator it = jobs.begin(); it != jobs.end(); ++it)
+        {
+            file << "# " << it->comment << endl;
+            file << genConvertCommand(it->plan);
+            file << endl;
+        }
+    }
+
+    for (vector<string>::const_iterator dir = directories.begin(); dir != directories.end(); ++dir)
+    {
+        file << "echo Output created in cards/" << *dir << "/" << endl;
+    }
+    file << endl;
+
+    return 0;
+}
+
+
+/**
+ * Write the 'convert' command for a job as a Makefile recipe. Recipe lines
+ * need a leading tab and any '$' doubled.
+ *
+ * @param  file - the Makefile.
+ * @param  plan - the render plan of the job.
+ */
+static void writeRecipe(ostream & file, const renderPlan & plan)
+{
+    string command = genConvertCommand(plan);
+    for (size_t pos = command.find('$'); pos != string::npos; pos = command.find('$', pos + 2))
+    {
+        command.insert(pos, 1, '$');
+    }
+    file << "\t" << command;
+}
+
+
+/**
+ * Generate a Makefile with a rule for each card, so that only the cards whose
+ * image files have changed are redrawn.
+ *
+ * @param  argc - command line argument count.
+ * @param  argv - command line argument vector.
+ * @param  jobs - list of card jobs.
+ * @param  directories - list of output directories.
+ * @return error value or 0 if no errors.
+ */
+int generateMakefile(int argc, char *argv[], const vector<job> & jobs, const vector<string> & directories)
+{
+    vector<job> assetJobs;
+    generateAssetJobs(jobs, assetJobs);
+
+    ofstream file(makeFilename.c_str());
+
+//- Open the Makefile for writing.
+    if (!file)
+    {
+        cerr << "Can't open output file " << makeFilename << " - aborting!" << endl;
+
+        return 1;
+    }
+
+//- Generate the initial preamble of the Makefile.
+    file << "# This file was generated as \"" << makeFilename << "\" using the following command:" << endl;
+    file << "#" << endl;
+    file << "#  ";
+    for (int i = 0; i < argc; ++i)
+    {
+        file << argv[i] << ' ';
+    }
+    file << endl;
+    file << "#" << endl;
+    file << endl;
+    file << "CARDS = \\" << endl;
+    for (vector<job>::const_iterator it = jobs.begin(); it != jobs.end(); ++it)
+    {
+        file << "\t" << it->fileName << " \\" << endl;
+    }
+    file << endl;
+    file << "all: $(CARDS)" << endl;
+    for (vector<string>::const_iterator dir = directories.begin(); dir != directories.end(); ++dir)
+    {
+        file << "\t@echo Output created in cards/" << *dir << "/" << endl;
+    }
     file << endl;
+    for (vector<string>::const_iterator dir = directories.begin(); dir != directories.end(); ++dir)
+    {
+        file << "cards/" << *dir << ":" << endl;
+        file << "\tmkdir -p cards/" << *dir << endl;
+        file << endl;
+    }
+    file << ".PHONY: all" << endl;
+    file << endl;
+
+//- Generate a rule for each scaled or rotated asset.
+    for (vector<job>::const_iterator it = assetJobs.begin(); it != assetJobs.end(); ++it)
+    {
+        file << "# " << it->comment << endl;
+        file << it->fileName << ": " << it->inputs.front() << endl;
+        file << "\tmkdir -p $(@D)" << endl;
+        writeRecipe(file, it->plan);
+        file << endl;
+    }
+
+//- Generate a rule for each card, dependent on the image files it uses.
+    for (vector<job>::const_iterator it = jobs.begin(); it != jobs.end(); ++it)
+    {
+        file << "# " << it->comment << endl;
+        file << it->fileName << ":";
+        for (vector<string>::const_iterator input = it->inputs.begin(); input != it->inputs.end(); ++input)
+        {
+            file << ' ' << *input;
+        }
+        const vector<string> prepared = getPreparedFiles(it->plan);
+        for (vector<string>::const_iterator input = prepared.begin(); input != prepared.end(); ++input)
+        {
+            file << ' ' << *input;
+        }
+        file << " | " << it->fileName.substr(0, it->fileName.rfind('/')) << endl;
+        writeRecipe(file, it->plan);
+        file << endl;
+    }
 
     return 0;
 }
@@ -0,0 +1,659 @@
+/**
+ * @file    encoder.cpp
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ *
+ * The png encoder for rendered cards. The scanlines are filtered, then the
+ * image data is split into blocks that are compressed independently on worker
+ * threads and joined into a single zlib stream, in the same way as 'pigz'.
+ * Also the qoi encoder, which is much faster than png for proofs, and raw
+ * RGBA output, which the consumer can map straight into memory.
+ */
+
+#include <fstream>
+#include <algorithm>
+#include <thread>
+#include <string.h>
+#include <zlib.h>
+#include "encoder.h"
+
+#if defined __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+/**
+ * @section Internal constants and variables.
+ *
+ */
+
+static const size_t BLOCK_SIZE = 128 * 1024;    // Bytes of image data per block.
+static const size_t WINDOW_SIZE = 32 * 1024;    // Bytes of dictionary per block.
+
+static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+
+/**
+ * @section encoderState structure.
+ *
+ * Used to share the image being encoded between the worker threads.
+ */
+struct encoderState
+{
+    int width;
+    int height;
+    int channels;               // 4 for RGBA, 1 for palette indices.
+    const uint8_t * pixels;
+    int level;                  // 0 to store, 1 for RLE, up to 9 for smallest.
+    size_t stride;              // Bytes per filtered scanline, with filter type.
+    vector<uint8_t> filtered;   // The filtered scanlines.
+    vector<size_t> starts;      // Offset of each block in the filtered scanlines.
+    vector<string> blocks;      // Compressed data of each block.
+    vector<uLong> checksums;    // Adler-32 of each block.
+};
+
+
+/**
+ * @section scanline filters.
+ *
+ */
+
+/**
+ * Get the cost of a filtered scanline, as the sum of the bytes taken as
+ * signed values, which favours the filter giving the smallest differences.
+ *
+ * @param  p - the filtered scanline.
+ * @param  length - bytes in the scanline.
+ * @return the cost.
+ */
+static uint64_t getCost(const uint8_t * p, size_t length)
+{
+    uint64_t cost = 0;
+    size_t i = 0;
+
+#if defined __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = zero;
+    for (; i + 16 <= length; i += 16)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        const __m128i magnitude = _mm_min_epu8(v, _mm_sub_epi8(zero, v));
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(magnitude, zero));
+    }
+    cost = _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+#endif
+
+    for (; i < length; ++i)
+    {
+        cost += min<int>(p[i], 256 - p[i]);
+    }
+
+    return cost;
+}
+
+
+/**
+ * Filter a scanline with the "Sub" filter, the difference from the pixel to
+ * the left.
+ *
+ * @param  d - the filtered scanline.
+ * @param  row - the scanline.
+ * @param  length - bytes in the scanline.
+ * @param  bpp - bytes per pixel.
+ */
+static void filterSub(uint8_t * d, const uint8_t * row, size_t length, int bpp)
+{
+    size_t i = 0;
+    for (; i < size_t(bpp); ++i)
+    {
+        d[i] = row[i];
+    }
+
+#if defined __SSE2__
+    for (; i + 16 <= length; i += 16)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i *)(row + i));
+        const __m128i left = _mm_loadu_si128((const __m128i *)(row + i - bpp));
+        _mm_storeu_si128((__m128i *)(d + i), _mm_sub_epi8(v, left));
+    }
+#endif
+
+    for (; i < length; ++i)
+    {
+        d[i] = row[i] - row[i - bpp];
+    }
+}
+
+
+/**
+ * Filter a scanline with the "Up" filter, the difference from the pixel
+ * above.
+ *
+ * @param  d - the filtered scanline.
+ * @param  row - the scanline.
+ * @param  prior - the scanline above.
+ * @param  length - bytes in the scanline.
+ */
+static void filterUp(uint8_t * d, const uint8_t * row, const uint8_t * prior, size_t length)
+{
+    size_t i = 0;
+
+#if defined __SSE2__
+    for (; i + 16 <= length; i += 16)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i *)(row + i));
+        const __m128i up = _mm_loadu_si128((const __m128i *)(prior + i));
+        _mm_storeu_si128((__m128i *)(d + i), _mm_sub_epi8(v, up));
+    }
+#endif
+
+    for (; i < length; ++i)
+    {
+        d[i] = row[i] - prior[i];
+    }
+}
+
+
+/**
+ * Filter a scanline with the "Average" filter, the difference from the mean
+ * of the pixels to the left and above.
+ *
+ * @param  d - the filtered scanline.
+ * @param  row - the scanline.
+ * @param  prior - the scanline above.
+ * @param  length - bytes in the scanline.
+ * @param  bpp - bytes per pixel.
+ */
+static void filterAverage(uint8_t * d, const uint8_t * row, const uint8_t * prior, size_t length, int bpp)
+{
+    for (size_t i = 0; i < length; ++i)
+    {
+        const int left = (i >= size_t(bpp)) ? row[i - bpp] : 0;
+        d[i] = row[i] - ((left + prior[i]) >> 1);
+    }
+}
+
+
+/**
+ * Filter a scanline with the "Paeth" filter, the difference from whichever
+ * of the pixels to the left, above and above left best predicts the pixel.
+ *
+ * @param  d - the filtered scanline.
+ * @param  row - the scanline.
+ * @param  prior - the scanline above.
+ * @param  length - bytes in the scanline.
+ * @param  bpp - bytes per pixel.
+ */
+static void filterPaeth(uint8_t * d, const uint8_t * row, const uint8_t * prior, size_t length, int bpp)
+{
+    for (size_t i = 0; i < length; ++i)
+    {
+        const int a = (i >= size_t(bpp)) ? row[i - bpp] : 0;
+        const int b = prior[i];
+        const int c = (i >= size_t(bpp)) ? prior[i - bpp] : 0;
+        const int pa = abs(b - c);
+        const int pb = abs(a - c);
+        const int pc = abs(a + b - 2 * c);
+        const int predictor = ((pa <= pb) && (pa <= pc)) ? a : (pb <= pc) ? b : c;
+        d[i] = row[i] - predictor;
+    }
+}
+
+
+/**
+ * Filter a range of scanlines. Palette images and stored images are not
+ * filtered, as recommended by the png specification, otherwise each scanline
+ * uses the filter with the lowest cost.
+ *
+ * @param  state - the image being encoded.
+ * @param  first - the first scanline.
+ * @param  last - the scanline after the last scanline.
+ */
+static void filterRows(encoderState & state, int first, int last)
+{
+    const size_t length = state.stride - 1;
+    const vector<uint8_t> zeros(length, 0);
+    vector<uint8_t> trial(length);
+
+    for (int y = first; y < last; ++y)
+    {
+        const uint8_t * row = state.pixels + y * length;
+        const uint8_t * prior = y ? row - length : zeros.data();
+        uint8_t * d = &state.filtered[y * state.stride];
+
+        d[0] = 0;
+        memcpy(d + 1, row, length);
+        if ((state.channels == 1) || (state.level == 0))
+            continue;
+
+        uint64_t best = getCost(d + 1, length);
+        for (int type = 1; type <= 4; ++type)
+        {
+            switch (type)
+            {
+            case 1: filterSub(trial.data(), row, length, state.channels);               break;
+            case 2: filterUp(trial.data(), row, prior, length);                         break;
+            case 3: filterAverage(trial.data(), row, prior, length, state.channels);    break;
+            case 4: filterPaeth(trial.data(), row, prior, length, state.channels);      break;
+            }
+
+            const uint64_t cost = getCost(trial.data(), length);
+            if (cost < best)
+            {
+                best = cost;
+                d[0] = type;
+                memcpy(d + 1, trial.data(), length);
+            }
+        }
+    }
+}
+
+
+/**
+ * @section compression.
+ *
+ */
+
+/**
+ * Compress a block of the filtered scanlines as raw deflate data. Each block
+ * is primed with the data before it, so the compression is nearly as good
+ * as a single stream. Every block but the last ends on a byte boundary, so
+ * the blocks can be joined. The block fails unless all of its data is
+ * compressed, and the last block finishes the stream.
+ *
+ * @param  state - the image being encoded.
+ * @param  block - index of the block.
+ * @return error value or 0 if no errors.
+ */
+static int compressBlock(encoderState & state, size_t block)
+{
+    const size_t start = state.starts[block];
+    const size_t end = (block + 1 < state.starts.size()) ? state.starts[block + 1] : state.filtered.size();
+    const bool last = (block + 1 == state.starts.size());
+    Bytef * input = &state.filtered[0];
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    const int strategy = (state.level == 1) ? Z_RLE : (state.channels == 1) ? Z_DEFAULT_STRATEGY : Z_FILTERED;
+    if (deflateInit2(&stream, state.level, Z_DEFLATED, -15, 8, strategy) != Z_OK)
+        return 1;
+
+    if (start)
+    {
+        const size_t window = min(start, WINDOW_SIZE);
+        deflateSetDictionary(&stream, input + start - window, window);
+    }
+
+    string & output = state.blocks[block];
+    output.resize(deflateBound(&stream, end - start) + 16);
+    stream.next_in = input + start;
+    stream.avail_in = end - start;
+    stream.next_out = (Bytef *)&output[0];
+    stream.avail_out = output.size();
+
+    // The output buffer is sized so that one call takes the whole block. A
+    // block that was only partly taken, or a flush that filled the buffer
+    // and may have more to give, would leave a corrupt stream.
+    const int ret = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+    const bool complete = (ret == (last ? Z_STREAM_END : Z_OK)) && (stream.avail_in == 0) && ((last) || (stream.avail_out != 0));
+    output.resize(output.size() - stream.avail_out);
+    deflateEnd(&stream);
+    if (!complete)
+        return 1;
+
+    state.checksums[block] = adler32(1L, input + start, end - start);
+
+    return 0;
+}
+
+
+/**
+ * Filter the scanlines and compress the blocks taken by a worker.
+ *
+ * @param  state - the image being encoded.
+ * @param  worker - index of the worker.
+ * @param  workers - number of workers.
+ * @param  failures - incremented for each block that can't be compressed.
+ */
+static void encodeWorker(encoderState & state, int worker, int workers, int & failures)
+{
+    for (size_t block = worker; block < state.starts.size(); block += workers)
+    {
+        failures += compressBlock(state, block);
+    }
+}
+
+
+/**
+ * Filter the scanlines taken by a worker.
+ *
+ * @param  state - the image being encoded.
+ * @param  worker - index of the worker.
+ * @param  workers - number of workers.
+ */
+static void filterWorker(encoderState & state, int worker, int workers)
+{
+    const int rows = (state.height + workers - 1) / workers;
+    filterRows(state, min(state.height, worker * rows), min(state.height, (worker + 1) * rows));
+}
+
+
+/**
+ * @section png file.
+ *
+ */
+
+/**
+ * Append a 32-bit big endian value.
+ *
+ * @param  data - the data to append to.
+ * @param  value - the value.
+ */
+static void appendValue(string & data, uint32_t value)
+{
+    data += char(value >> 24);
+    data += char(value >> 16);
+    data += char(value >> 8);
+    data += char(value);
+}
+
+
+/**
+ * Write a png chunk.
+ *
+ * @param  file - the png file.
+ * @param  type - the chunk type.
+ * @param  data - the chunk data.
+ */
+static void writeChunk(ofstream & file, const char * type, const string & data)
+{
+    string chunk;
+    appendValue(chunk, data.size());
+    chunk += type;
+    chunk += data;
+    const uLong crc = crc32(crc32(0L, (const Bytef *)type, 4), (const Bytef *)data.data(), data.size());
+    appendValue(chunk, crc);
+
+    file.write(chunk.data(), chunk.size());
+}
+
+
+/**
+ * Write an image as a png file.
+ *
+ * @param  fileName - name of the png file.
+ * @param  width - width of the image in pixels.
+ * @param  height - height of the image in pixels.
+ * @param  channels - 4 for RGBA pixels, or 1 for palette indices.
+ * @param  pixels - the RGBA pixels, not premultiplied, or palette indices.
+ * @param  colourMap - RGBA colour of each palette entry.
+ * @param  level - 0 to store, 1 for fast RLE, up to 9 for the smallest file.
+ * @param  threads - number of threads to use.
+ * @return error value or 0 if no errors.
+ */
+int writePng(const string & fileName, int width, int height, int channels, const uint8_t * pixels, const vector<uint8_t> & colourMap, int level, int threads)
+{
+    encoderState state;
+    state.width = width;
+    state.height = height;
+    state.channels = channels;
+    state.pixels = pixels;
+    state.level = max(0, min(level, 9));
+    state.stride = size_t(width) * channels + 1;
+    state.filtered.resize(state.stride * height);
+
+    for (size_t start = 0; start < state.filtered.size(); start += BLOCK_SIZE)
+    {
+        state.starts.push_back(start);
+    }
+    if (state.starts.empty())
+    {
+        state.starts.push_back(0);
+    }
+    state.blocks.resize(state.starts.size());
+    state.checksums.resize(state.starts.size());
+
+//- Filter the scanlines, then compress the blocks, sharing them between the threads.
+    const int workers = max(1, min<int>(threads, state.starts.size()));
+    vector<thread> pool;
+    for (int i = 1; i < workers; ++i)
+    {
+        pool.push_back(thread(filterWorker, ref(state), i, workers));
+    }
+    filterWorker(state, 0, workers);
+    for (vector<thread>::iterator it = pool.begin(); it != pool.end(); ++it)
+    {
+        it->join();
+    }
+
+    pool.clear();
+    vector<int> failures(workers, 0);
+    for (int i = 1; i < workers; ++i)
+    {
+        pool.push_back(thread(encodeWorker, ref(state), i, workers, ref(failures[i])));
+    }
+    encodeWorker(state, 0, workers, failures[0]);
+    for (vector<thread>::iterator it = pool.begin(); it != pool.end(); ++it)
+    {
+        it->join();
+    }
+    if (count(failures.begin(), failures.end(), 0) != workers)
+    {
+        return 1;
+    }
+
+//- Join the blocks into a zlib stream.
+    static const uint8_t headers[4][2] = { { 0x78, 0x01 }, { 0x78, 0x5E }, { 0x78, 0x9C }, { 0x78, 0xDA } };
+    const int speed = (state.level < 2) ? 0 : (state.level < 6) ? 1 : (state.level == 6) ? 2 : 3;
+    string data;
+    data += char(headers[speed][0]);
+    data += char(headers[speed][1]);
+    uLong checksum = state.checksums[0];
+    for (size_t i = 0; i < state.blocks.size(); ++i)
+    {
+        data += state.blocks[i];
+        if (i)
+        {
+            const size_t end = (i + 1 < state.starts.size()) ? state.starts[i + 1] : state.filtered.size();
+            checksum = adler32_combine(checksum, state.checksums[i], end - state.starts[i]);
+        }
+    }
+    appendValue(data, checksum);
+
+//- Write the png file.
+    ofstream file(fileName.c_str(), ofstream::out|ofstream::binary|ofstream::trunc);
+    if (!file)
+    {
+        return 1;
+    }
+
+    string header;
+    appendValue(header, width);
+    appendValue(header, height);
+    header += char(8);                          // Bit depth.
+    header += char((channels == 1) ? 3 : 6);    // Palette or RGBA.
+    header += string(3, '\0');                  // Compression, filter and interlace methods.
+
+    file.write((const char *)signature, sizeof(signature));
+    writeChunk(file, "IHDR", header);
+    if (channels == 1)
+    {
+        string entries;
+        string alpha;
+        size_t transparent = 0;     // Entries up to the last that isn't opaque.
+        for (size_t i = 0; i + 3 < colourMap.size(); i += 4)
+        {
+            entries.append((const char *)&colourMap[i], 3);
+            alpha += char(colourMap[i + 3]);
+            if (colourMap[i + 3] != 0xFF)
+                transparent = alpha.size();
+        }
+        writeChunk(file, "PLTE", entries);
+        if (transparent)
+        {
+            writeChunk(file, "tRNS", alpha.substr(0, transparent));
+        }
+    }
+    writeChunk(file, "IDAT", data);
+    writeChunk(file, "IEND", "");
+
+    return file ? 0 : 1;
+}
+
+
+
+/**
+ * @section qoi file.
+ *
+ */
+
+/**
+ * Write an image as a qoi ("Quite OK Image") file. Each pixel is coded, in a
+ * single pass, as a run of the previous pixel, an index into the 64 most
+ * recently seen colours, a small difference from the previous pixel, or in
+ * full.
+ *
+ * @param  fileName - name of the qoi file.
+ * @param  width - width of the image in pixels.
+ * @param  height - height of the image in pixels.
+ * @param  pixels - the RGBA pixels, not premultiplied.
+ * @return error value or 0 if no errors.
+ */
+int writeQoi(const string & fileName, int width, int height, const uint8_t * pixels)
+{
+    static const uint8_t QOI_INDEX = 0x00;
+    static const uint8_t QOI_DIFF  = 0x40;
+    static const uint8_t QOI_LUMA  = 0x80;
+    static const uint8_t QOI_RUN   = 0xC0;
+    static const uint8_t QOI_RGB   = 0xFE;
+    static const uint8_t QOI_RGBA  = 0xFF;
+
+    const size_t count = size_t(width) * height;
+    string data;
+    data.reserve(14 + count * 5 + 8);
+    data += "qoif";
+    appendValue(data, width);
+    appendValue(data, height);
+    data += char(4);                            // RGBA.
+    data += char(0);                            // sRGB with linear alpha.
+
+    uint8_t seen[64][4];
+    memset(seen, 0, sizeof(seen));
+    uint8_t previous[4] = { 0, 0, 0, 255 };
+    int run = 0;
+    const uint8_t * p = pixels;
+    for (size_t i = 0; i < count; ++i, p += 4)
+    {
+        if (memcmp(p, previous, 4) == 0)
+        {
+            ++run;
+            if ((run == 62) || (i + 1 == count))
+            {
+                data += char(QOI_RUN | (run - 1));
+                run = 0;
+            }
+            continue;
+        }
+
+        if (run)
+        {
+            data += char(QOI_RUN | (run - 1));
+            run = 0;
+        }
+
+        const int slot = (p[0] * 3 + p[1] * 5 + p[2] * 7 + p[3] * 11) % 64;
+        if (memcmp(p, seen[slot], 4) == 0)
+        {
+            data += char(QOI_INDEX | slot);
+        }
+        else
+        {
+            memcpy(seen[slot], p, 4);
+            if (p[3] == previous[3])
+            {
+                const int8_t dr = p[0] - previous[0];
+                const int8_t dg = p[1] - previous[1];
+                const int8_t db = p[2] - previous[2];
+                const int8_t drg = dr - dg;
+                const int8_t dbg = db - dg;
+                if ((dr >= -2) && (dr <= 1) && (dg >= -2) && (dg <= 1) && (db >= -2) && (db <= 1))
+                {
+                    data += char(QOI_DIFF | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2));
+                }
+                else if ((dg >= -32) && (dg <= 31) && (drg >= -8) && (drg <= 7) && (dbg >= -8) && (dbg <= 7))
+                {
+                    data += char(QOI_LUMA | (dg + 32));
+                    data += char(((drg + 8) << 4) | (dbg + 8));
+                }
+                else
+                {
+                    data += char(QOI_RGB);
+                    data.append((const char *)p, 3);
+                }
+            }
+            else
+            {
+                data += char(QOI_RGBA);
+                data.append((const char *)p, 4);
+            }
+        }
+        memcpy(previous, p, 4);
+    }
+    data.append(7, '\0');                       // End marker.
+    data += char(1);
+
+    ofstream file(fileName.c_str(), ofstream::out|ofstream::binary|ofstream::trunc);
+    if (!file)
+    {
+        return 1;
+    }
+    file.write(data.data(), data.size());
+
+    return file ? 0 : 1;
+}
+
+
+/**
+ * @section raw file.
+ *
+ */
+
+/**
+ * Write an image as raw 8-bit RGBA, with no header, the same as ImageMagick's
+ * 'rgba:' format. The size of the image is not recorded.
+ *
+ * @param  fileName - name of the raw file.
+ * @param  width - width of the image in pixels.
+ * @param  height - height of the image in pixels.
+ * @param  pixels - the RGBA pixels, not premultiplied.
+ * @return error value or 0 if no errors.
+ */
+int writeRaw(const string & fileName, int width, int height, const uint8_t * pixels)
+{
+    ofstream file(fileName.c_str(), ofstream::out|ofstream::binary|ofstream::trunc);
+    if (!file)
+    {
+        return 1;
+    }
+    file.write((const char *)pixels, size_t(width) * height * 4);
+
+    return file ? 0 : 1;
+}
@@ -0,0 +1,40 @@
+/**
+ * @file    image.h
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ *
+ * Interface for the card image encoders.
+ */
+
+#if !defined _ENCODER_H_INCLUDED_
+#define _ENCODER_H_INCLUDED_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+extern int writePng(const string & fileName, int width, int height, int channels, const uint8_t * pixels, const vector<uint8_t> & colourMap, int level, int threads);
+extern int writeQoi(const string & fileName, int width, int height, const uint8_t * pixels);
+extern int writeRaw(const string & fileName, int width, int height, const uint8_t * pixels);
+
+#endif //!defined _ENCODER_H_INCLUDED_
@@ -0,0 +1,398 @@
+/**
+ * @file    exec.cpp
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ * Deck building. Either renders the cards natively or runs the drawing
+ * commands through a bounded pool of 'convert' processes.
+ */
+
+#include <iostream>
+#include <string>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "cardgen.h"
+
+
+/**
+ * @section process structure.
+ *
+ * Used to track a running card drawing command.
+ */
+struct process
+{
+    pid_t pid;
+    int fd;                 // Read end of the stderr pipe.
+    size_t index;           // Index of the job being run.
+    string errors;          // Captured stderr output.
+};
+
+
+/**
+ * @section main code.
+ *
+ */
+
+/**
+ * Create a directory path, including any missing parent directories.
+ *
+ * @param  path - directory path to create.
+ * @return error value or 0 if no errors.
+ */
+int makePath(const string & path)
+{
+    for (size_t pos = path.find('/', 1); ; pos = path.find('/', pos + 1))
+    {
+        const string dir = path.substr(0, pos);
+        if ((mkdir(dir.c_str(), 0755)) && (errno != EEXIST))
+        {
+            return 1;
+        }
+
+        if (pos == string::npos)
+            break;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Start a card drawing command directly, without a shell, with stderr
+ * captured by a pipe.
+ *
+ * @param  card - the card job.
+ * @param  proc - the process to populate.
+ * @return error value or 0 if no errors.
+ */
+static int spawn(const job & card, process & proc)
+{
+//- Build the argument vector before forking.
+    const vector<string> args = genConvertArgs(card.plan);
+    if (args.empty())
+    {
+        return 1;
+    }
+
+    vector<char *> argv;
+    for (vector<string>::const_iterator it = args.begin(); it != args.end(); ++it)
+    {
+        argv.push_back(const_cast<char *>(it->c_str()));
+    }
+    argv.push_back(NULL);
+
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC))
+    {
+        return 1;
+    }
+
+    const pid_t pid = fork();
+    if (pid < 0)
+    {
+        close(fds[0]);
+        close(fds[1]);
+
+        return 1;
+    }
+
+    if (pid == 0)
+    {
+        dup2(fds[1], STDERR_FILENO);
+        execvp(argv[0], &argv[0]);
+
+        const string message = string("Can't run ") + argv[0] + "\n";
+        write(STDERR_FILENO, message.c_str(), message.length());
+        _exit(127);
+    }
+
+    close(fds[1]);
+    proc.pid = pid;
+    proc.fd = fds[0];
+    proc.errors.clear();
+
+    return 0;
+}
+
+
+/**
+ * Wait for a card drawing command to finish and report any problems.
+ *
+ * @param  card - the card job.
+ * @param  proc - the finished process.
+ * @return error value or 0 if no errors.
+ */
+static int reap(const job & card, process & proc)
+{
+    int status;
+
+    close(proc.fd);
+    while ((waitpid(proc.pid, &status, 0) < 0) && (errno == EINTR))
+        ;
+
+    const bool failed = (!WIFEXITED(status)) || (WEXITSTATUS(status) != 0);
+    if (failed)
+    {
+        cerr << "Failed to draw " << card.fileName;
+        if (WIFEXITED(status))
+            cerr << " (exit status " << WEXITSTATUS(status) << ")";
+        else
+            cerr << " (signal " << WTERMSIG(status) << ")";
+        cerr << endl;
+    }
+
+    cerr << proc.errors;
+
+    return failed ? 1 : 0;
+}
+
+
+/**
+ * Run the card drawing commands through a bounded pool of processes. Once a
+ * command fails no further commands are started, but those already running
+ * are allowed to finish.
+ *
+ * @param  jobs - list of card jobs.
+ * @param  workers - maximum number of concurrent processes.
+ * @return error value or 0 if no errors.
+ */
+int executeJobs(const vector<job> & jobs, int workers)
+{
+    vector<process> running;
+    vector<pollfd> fds;
+    size_t next = 0;
+    int failures = 0;
+
+    while (((!failures) && (next < jobs.size())) || (!running.empty()))
+    {
+//- Top up the pool.
+        while ((!failures) && (next < jobs.size()) && (running.size() < size_t(workers)))
+        {
+            process proc;
+            proc.index = next++;
+            if (spawn(jobs[proc.index], proc))
+            {
+                cerr << "Can't start command for " << jobs[proc.index].fileName << endl;
+                ++failures;
+                break;
+            }
+            running.push_back(proc);
+        }
+
+        if (running.empty())
+            break;
+
+//- Wait for output or completion of any running command.
+        fds.resize(running.size());
+        for (size_t i = 0; i < running.size(); ++i)
+        {
+            fds[i].fd = running[i].fd;
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+        }
+
+        if ((poll(&fds[0], fds.size(), -1) < 0) && (errno != EINTR))
+        {
+            cerr << "Can't wait for commands - aborting!" << endl;
+
+            return 1;
+        }
+
+        for (size_t i = fds.size(); i-- > 0; )
+        {
+            if (!fds[i].revents)
+                continue;
+
+            char buffer[4096];
+            const ssize_t count = read(running[i].fd, buffer, sizeof(buffer));
+            if (count > 0)
+            {
+                running[i].errors.append(buffer, count);
+                continue;
+            }
+
+            if ((count < 0) && (errno == EINTR))
+                continue;
+
+            // End of stderr, so the command has finished.
+            failures += reap(jobs[running[i].index], running[i]);
+            running.erase(running.begin() + i);
+        }
+    }
+
+    if (failures)
+    {
+        cerr << failures << " card(s) failed - aborting!" << endl;
+
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Run the drawing commands for the cards, after preparing the rotated assets
+ * that they use.
+ *
+ * @param  jobs - list of card jobs.
+ * @return error value or 0 if no errors.
+ */
+static int convertJobs(const vector<job> & jobs)
+{
+    vector<job> assetJobs;
+    generateAssetJobs(jobs, assetJobs);
+
+    for (vector<job>::const_iterator it = assetJobs.begin(); it != assetJobs.end(); ++it)
+    {
+        const string path = it->fileName.substr(0, it->fileName.rfind('/'));
+        if (makePath(path))
+        {
+            cerr << "Can't create directory " << path << " - aborting!" << endl;
+
+            return 1;
+        }
+    }
+
+    if (executeJobs(assetJobs, jobCount))
+    {
+        return 1;
+    }
+
+    return executeJobs(jobs, jobCount);
+}
+
+
+/**
+ * Draw the cards, either by rendering them natively or by running the drawing
+ * commands. When the cache is in use, cards found in it are copied instead and
+ * newly drawn cards are added to it.
+ *
+ * @param  jobs - list of card jobs.
+ * @return error value or 0 if no errors.
+ */
+static int drawCards(const vector<job> & jobs)
+{
+    if (!useCache)
+    {
+        return renderImages ? renderJobs(jobs) : convertJobs(jobs);
+    }
+
+    if (makePath(cacheDirectory))
+    {
+        cerr << "Can't create cache directory " << cacheDirectory << " - aborting!" << endl;
+
+        return 1;
+    }
+
+//- Use cached card images where possible.
+    vector<string> cardKeys;
+    for (vector<job>::const_iterator it = jobs.begin(); it != jobs.end(); ++it)
+    {
+        cardKeys.push_back(getCacheKey(*it));
+    }
+    if ((renderImages) && (sharedPalette))
+    {
+        shareCacheKeys(cardKeys);
+    }
+
+    vector<job> pending;
+    vector<string> keys;
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        if (!fetchFromCache(cardKeys[i], jobs[i].fileName))
+        {
+            // Break any link to a cache entry before the card is redrawn.
+            unlink(jobs[i].fileName.c_str());
+            pending.push_back(jobs[i]);
+            keys.push_back(cardKeys[i]);
+        }
+    }
+
+//- Draw the rest and add them to the cache.
+    if (pending.size())
+    {
+        const int ret = renderImages ? renderJobs(pending) : convertJobs(pending);
+        if (ret)
+        {
+            return ret;
+        }
+
+        for (size_t i = 0; i < pending.size(); ++i)
+        {
+            if (storeInCache(keys[i], pending[i].fileName))
+            {
+                cerr << "Can't add " << pending[i].fileName << " to the cache" << endl;
+            }
+        }
+    }
+
+    cout << "Cache: " << (jobs.size() - pending.size()) << " hits, " << pending.size() << " misses" << endl;
+
+    return 0;
+}
+
+
+/**
+ * Build all the cards in the job list, either by rendering them natively or by
+ * running the drawing commands, instead of generating the script.
+ *
+ * @param  jobs - list of card jobs.
+ * @param  directories - list of output directories.
+ * @return error value or 0 if no errors.
+ */
+int buildDeck(const vector<job> & jobs, const vector<string> & directories)
+{
+//- Make the directories.
+    for (vector<string>::const_iterator dir = directories.begin(); dir != directories.end(); ++dir)
+    {
+        const string path = string("cards/") + *dir;
+        if (makePath(path))
+        {
+            cerr << "Can't create output directory " << path << " - aborting!" << endl;
+
+            return 1;
+        }
+    }
+
+//- Draw the cards.
+    const int ret = drawCards(jobs);
+    if (ret)
+    {
+        return ret;
+    }
+
+//- Pack the cards into sheets.
+    if ((atlasSize) && (buildAtlases(jobs, directories)))
+    {
+        return 1;
+    }
+
+    for (vector<string>::const_iterator dir = directories.begin(); dir != directories.end(); ++dir)
+    {
+        cout << "Output created in cards/" << *dir << "/" << endl;
+    }
+
+    return 0;
+}
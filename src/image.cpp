@@ -0,0 +1,939 @@
+/**
+ * @file    image.cpp
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ * Implementation for the image class.
+ */
+
+#include "cardgen.h"
+#include "image.h"
+#include "palette.h"
+#include "encoder.h"
+#include "archive.h"
+#include "over.h"
+
+#include <png.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <algorithm>
+
+#if defined __x86_64__ || defined __i386__
+#include <immintrin.h>
+#define X86_SIMD
+#endif
+
+
+/**
+ * @section Internal constants and variables.
+ *
+ */
+
+static const struct
+{
+    const char * name;
+    uint32_t colour;
+}
+    colourNames[] =
+{
+    { "none",           0x00000000 },
+    { "transparent",    0x00000000 },
+    { "white",          0xFFFFFFFF },
+    { "black",          0x000000FF },
+    { "red",            0xFF0000FF },
+    { "green",          0x008000FF },
+    { "lime",           0x00FF00FF },
+    { "blue",           0x0000FFFF },
+    { "yellow",         0xFFFF00FF },
+    { "cyan",           0x00FFFFFF },
+    { "magenta",        0xFF00FFFF },
+    { "gray",           0x7E7E7EFF },
+    { "grey",           0xBEBEBEFF },
+    { "silver",         0xC0C0C0FF },
+    { "lightgray",      0xD3D3D3FF },
+    { "lightgrey",      0xD3D3D3FF },
+    { "whitesmoke",     0xF5F5F5FF },
+    { "snow",           0xFFFAFAFF },
+    { "ivory",          0xFFFFF0FF },
+    { "beige",          0xF5F5DCFF },
+    { "linen",          0xFAF0E6FF },
+    { "seashell",       0xFFF5EEFF },
+    { "oldlace",        0xFDF5E6FF },
+    { "cornsilk",       0xFFF8DCFF },
+    { "floralwhite",    0xFFFAF0FF },
+    { "ghostwhite",     0xF8F8FFFF },
+    { "antiquewhite",   0xFAEBD7FF },
+    { "navajowhite",    0xFFDEADFF },
+    { "lightyellow",    0xFFFFE0FF },
+    { "lemonchiffon",   0xFFFACDFF },
+    { "honeydew",       0xF0FFF0FF },
+    { "mintcream",      0xF5FFFAFF },
+    { "azure",          0xF0FFFFFF },
+    { "aliceblue",      0xF0F8FFFF },
+    { "lavender",       0xE6E6FAFF },
+    { "wheat",          0xF5DEB3FF },
+    { "khaki",          0xF0E68CFF },
+    { "gold",           0xFFD700FF },
+    { "orange",         0xFFA500FF },
+    { "pink",           0xFFC0CBFF },
+    { "purple",         0x800080FF },
+    { "navy",           0x000080FF },
+};
+
+static const struct
+{
+    const char * name;
+    filterType filter;
+}
+    filterNames[] =
+{
+    { "box",            BOX_FILTER },
+    { "bilinear",       BILINEAR_FILTER },
+    { "lanczos",        LANCZOS_FILTER },
+};
+
+
+/**
+ * @section main code.
+ *
+ */
+
+/**
+ * Multiply the colour channels of a row of RGBA pixels by their alpha.
+ *
+ * @param  p - first pixel of the row.
+ * @param  count - number of pixels.
+ */
+static void premultiply(uint8_t * p, int count)
+{
+    for (int i = 0; i < count; ++i, p += 4)
+    {
+        const int a = p[3];
+        if (a == 255)
+            continue;
+
+        p[0] = (p[0] * a + 127) / 255;
+        p[1] = (p[1] * a + 127) / 255;
+        p[2] = (p[2] * a + 127) / 255;
+    }
+}
+
+
+/**
+ * Divide the colour channels of a row of premultiplied RGBA pixels by their
+ * alpha.
+ *
+ * @param  p - first pixel of the row.
+ * @param  count - number of pixels.
+ */
+static void unpremultiply(uint8_t * p, int count)
+{
+    for (int i = 0; i < count; ++i, p += 4)
+    {
+        const int a = p[3];
+        if ((a == 255) || (a == 0))
+            continue;
+
+        p[0] = min(255, (p[0] * 255 + a/2) / a);
+        p[1] = min(255, (p[1] * 255 + a/2) / a);
+        p[2] = min(255, (p[2] * 255 + a/2) / a);
+    }
+}
+
+
+/**
+ * @section resampling filters and kernels.
+ *
+ * Resampling is separable: each destination pixel is a weighted sum of a
+ * fixed number of neighbouring source pixels in one direction. The weights
+ * are calculated once per size and held as 16-bit fixed point values with
+ * WEIGHT_BITS fractional bits, so the vector kernels give exactly the same
+ * result as the scalar kernels.
+ */
+
+static const int WEIGHT_BITS = 14;
+
+/**
+ * Get the radius of a filter, in source pixels when not reducing the image.
+ *
+ * @param  filter - resampling filter.
+ * @return the radius.
+ */
+static double getSupport(filterType filter)
+{
+    switch (filter)
+    {
+    case BOX_FILTER:        return 0.5;
+    case BILINEAR_FILTER:   return 1.0;
+    case LANCZOS_FILTER:    return 3.0;
+    }
+
+    return 1.0;
+}
+
+
+/**
+ * Evaluate a filter.
+ *
+ * @param  filter - resampling filter.
+ * @param  x - distance from the centre of the filter.
+ * @return the unnormalised weight.
+ */
+static double evaluate(filterType filter, double x)
+{
+    x = fabs(x);
+
+    switch (filter)
+    {
+    case BOX_FILTER:
+        return (x < 0.5) ? 1.0 : 0.0;
+
+    case BILINEAR_FILTER:
+        return (x < 1.0) ? 1.0 - x : 0.0;
+
+    case LANCZOS_FILTER:
+        if (x < 1e-6)
+            return 1.0;
+
+        if (x >= 3.0)
+            return 0.0;
+
+        return 3.0 * sin(M_PI * x) * sin(M_PI * x / 3.0) / (M_PI * M_PI * x * x);
+    }
+
+    return 0.0;
+}
+
+
+/**
+ * @section filterWeights structure.
+ *
+ * Used to hold the source pixels and weights for each destination pixel in
+ * one direction. Every destination pixel uses the same number of source
+ * pixels, starting at first, so the weights are stored taps at a time.
+ */
+struct filterWeights
+{
+    int taps;                   // Source pixels used by each destination pixel.
+    vector<int> first;          // First source pixel for each destination pixel.
+    vector<int16_t> weights;    // Weights for each destination pixel.
+
+    filterWeights(int source, int dest, filterType filter);
+};
+
+
+/**
+ * Calculate the weights needed to resample a row or column of pixels. When
+ * the image is reduced the filter is widened to cover the source pixels that
+ * fall in each destination pixel. Source pixels beyond the edge of the image
+ * are replaced by the edge pixel.
+ *
+ * @param  source - number of source pixels.
+ * @param  dest - number of destination pixels.
+ * @param  filter - resampling filter.
+ */
+filterWeights::filterWeights(int source, int dest, filterType filter) : first(dest)
+{
+    const double scale = double(source) / dest;
+    const double stretch = max(scale, 1.0);
+    const double support = getSupport(filter) * stretch;
+
+    taps = min(source, int(ceil(support * 2)) + 2);
+    weights.resize(dest * taps);
+
+    vector<double> sums(taps);
+    for (int i = 0; i < dest; ++i)
+    {
+        const double centre = (i + 0.5) * scale;
+        const int lo = int(floor(centre - support));
+        const int hi = int(ceil(centre + support));
+        first[i] = max(0, min(lo, source - taps));
+
+        fill(sums.begin(), sums.end(), 0.0);
+        double total = 0.0;
+        for (int j = lo; j <= hi; ++j)
+        {
+            const double weight = evaluate(filter, (j + 0.5 - centre) / stretch);
+            sums[max(0, min(j, source - 1)) - first[i]] += weight;
+            total += weight;
+        }
+
+        if (total == 0.0)
+        {
+            // No source pixel is close enough, so use the nearest one.
+            sums[max(0, min(int(centre), source - 1)) - first[i]] = 1.0;
+            total = 1.0;
+        }
+
+        // Make the fixed point weights add up to exactly 1.
+        int16_t * w = &weights[i * taps];
+        int sum = 0;
+        int largest = 0;
+        for (int k = 0; k < taps; ++k)
+        {
+            w[k] = int16_t(lround(sums[k] / total * (1 << WEIGHT_BITS)));
+            sum += w[k];
+            if (w[k] > w[largest])
+                largest = k;
+        }
+        w[largest] += (1 << WEIGHT_BITS) - sum;
+    }
+}
+
+
+/**
+ * Convert a fixed point weighted sum to a channel value.
+ *
+ * @param  sum - the weighted sum.
+ * @return the channel value.
+ */
+static inline uint8_t toChannel(int sum)
+{
+    return max(0, min(255, (sum + (1 << (WEIGHT_BITS - 1))) >> WEIGHT_BITS));
+}
+
+
+/**
+ * Resample a row of pixels horizontally one channel at a time.
+ *
+ * @param  d - first destination pixel.
+ * @param  s - first source pixel.
+ * @param  count - number of destination pixels.
+ * @param  columns - source pixels and weights for each destination pixel.
+ */
+static void horizontalScalar(uint8_t * d, const uint8_t * s, int count, const filterWeights & columns)
+{
+    for (int x = 0; x < count; ++x, d += 4)
+    {
+        const uint8_t * p = s + columns.first[x] * 4;
+        const int16_t * w = &columns.weights[x * columns.taps];
+        int sum[4] = { 0, 0, 0, 0 };
+        for (int k = 0; k < columns.taps; ++k, p += 4)
+        {
+            for (int c = 0; c < 4; ++c)
+                sum[c] += p[c] * w[k];
+        }
+
+        for (int c = 0; c < 4; ++c)
+            d[c] = toChannel(sum[c]);
+    }
+}
+
+
+/**
+ * Resample a row of pixels vertically one byte at a time.
+ *
+ * @param  d - first destination byte.
+ * @param  s - the source rows.
+ * @param  length - number of bytes in a row.
+ * @param  w - weight of each source row.
+ * @param  taps - number of source rows.
+ */
+static void verticalScalar(uint8_t * d, const uint8_t * const * s, int length, const int16_t * w, int taps)
+{
+    for (int i = 0; i < length; ++i)
+    {
+        int sum = 0;
+        for (int k = 0; k < taps; ++k)
+            sum += s[k][i] * w[k];
+
+        d[i] = toChannel(sum);
+    }
+}
+
+#if defined X86_SIMD
+/**
+ * Resample a row of pixels horizontally using SSE2, a pixel and two source
+ * pixels at a time.
+ *
+ * @param  d - first destination pixel.
+ * @param  s - first source pixel.
+ * @param  count - number of destination pixels.
+ * @param  columns - source pixels and weights for each destination pixel.
+ */
+__attribute__((target("sse2")))
+static void horizontalSSE2(uint8_t * d, const uint8_t * s, int count, const filterWeights & columns)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i half = _mm_set1_epi32(1 << (WEIGHT_BITS - 1));
+    const int taps = columns.taps;
+
+    for (int x = 0; x < count; ++x, d += 4)
+    {
+        const uint8_t * p = s + columns.first[x] * 4;
+        const int16_t * w = &columns.weights[x * taps];
+        __m128i sum = half;
+
+        int k = 0;
+        for (; k + 2 <= taps; k += 2, p += 8)
+        {
+            const __m128i pair = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)p), zero);
+            const __m128i channels = _mm_unpacklo_epi16(pair, _mm_srli_si128(pair, 8));
+            const __m128i weight = _mm_set1_epi32((uint16_t)w[k] | ((uint32_t)(uint16_t)w[k + 1] << 16));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(channels, weight));
+        }
+        if (k < taps)
+        {
+            uint32_t last;
+            memcpy(&last, p, 4);
+            const __m128i pixel = _mm_unpacklo_epi8(_mm_cvtsi32_si128(last), zero);
+            const __m128i channels = _mm_unpacklo_epi16(pixel, zero);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(channels, _mm_set1_epi32((uint16_t)w[k])));
+        }
+
+        sum = _mm_srai_epi32(sum, WEIGHT_BITS);
+        sum = _mm_packs_epi32(sum, sum);
+        const uint32_t pixel = _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+        memcpy(d, &pixel, 4);
+    }
+}
+
+
+/**
+ * Resample a row of pixels vertically using SSE2, 8 bytes and two source
+ * rows at a time.
+ *
+ * @param  d - first destination byte.
+ * @param  s - the source rows.
+ * @param  length - number of bytes in a row.
+ * @param  w - weight of each source row.
+ * @param  taps - number of source rows.
+ */
+__attribute__((target("sse2")))
+static void verticalSSE2(uint8_t * d, const uint8_t * const * s, int length, const int16_t * w, int taps)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i half = _mm_set1_epi32(1 << (WEIGHT_BITS - 1));
+
+    int i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        __m128i lo = half;
+        __m128i hi = half;
+
+        for (int k = 0; k < taps; k += 2)
+        {
+            const bool pair = (k + 1 < taps);
+            const __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(s[k] + i)), zero);
+            const __m128i b = pair ? _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(s[k + 1] + i)), zero) : zero;
+            const __m128i weight = _mm_set1_epi32((uint16_t)w[k] | (pair ? (uint32_t)(uint16_t)w[k + 1] << 16 : 0));
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), weight));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), weight));
+        }
+
+        lo = _mm_srai_epi32(lo, WEIGHT_BITS);
+        hi = _mm_srai_epi32(hi, WEIGHT_BITS);
+        const __m128i words = _mm_packs_epi32(lo, hi);
+        _mm_storel_epi64((__m128i *)(d + i), _mm_packus_epi16(words, words));
+    }
+
+    for (; i < length; ++i)
+    {
+        int sum = 0;
+        for (int k = 0; k < taps; ++k)
+            sum += s[k][i] * w[k];
+
+        d[i] = toChannel(sum);
+    }
+}
+#endif
+
+
+/**
+ * @section resampleKernels structure.
+ *
+ * Used to hold the fastest horizontal and vertical resampling kernels that
+ * the CPU supports.
+ */
+struct resampleKernels
+{
+    void (*horizontal)(uint8_t * d, const uint8_t * s, int count, const filterWeights & columns);
+    void (*vertical)(uint8_t * d, const uint8_t * const * s, int length, const int16_t * w, int taps);
+};
+
+
+/**
+ * Choose the fastest resampling kernels that the CPU supports.
+ *
+ * @return the kernels.
+ */
+static resampleKernels selectResampleKernels(void)
+{
+    resampleKernels kernels = { horizontalScalar, verticalScalar };
+
+#if defined X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+    {
+        kernels.horizontal = horizontalSSE2;
+        kernels.vertical = verticalSSE2;
+    }
+#endif
+
+    return kernels;
+}
+
+
+/**
+ * Read a png file into the image, replacing any existing pixels. A file in
+ * the asset archive is decoded in place.
+ *
+ * @param  fileName - name of the png file.
+ * @return error value or 0 if no errors.
+ */
+int image::load(const string & fileName)
+{
+    png_image png;
+    memset(&png, 0, sizeof(png));
+    png.version = PNG_IMAGE_VERSION;
+
+    const uint8_t * data;
+    size_t size;
+    if (archiveFiles.read(fileName, data, size))
+    {
+        if (!png_image_begin_read_from_memory(&png, data, size))
+            return 1;
+    }
+    else if (!png_image_begin_read_from_file(&png, fileName.c_str()))
+    {
+        return 1;
+    }
+
+    png.format = PNG_FORMAT_RGBA;
+    vector<uint8_t> buffer(PNG_IMAGE_SIZE(png));
+    if (!png_image_finish_read(&png, NULL, buffer.data(), 0, NULL))
+    {
+        png_image_free(&png);
+
+        return 1;
+    }
+
+    Width = png.width;
+    Height = png.height;
+    Pixels.swap(buffer);
+    premultiply(Pixels.data(), Width * Height);
+
+    return 0;
+}
+
+
+/**
+ * Check if the image still matches the palette it was quantised to.
+ *
+ * @return true if every pixel is its palette colour, false otherwise.
+ */
+bool image::isQuantised(void) const
+{
+    if ((Palette.empty()) || (Indices.size() != Pixels.size() / 4))
+        return false;
+
+    const uint8_t * p = Pixels.data();
+    for (size_t i = 0; i < Indices.size(); ++i, p += 4)
+    {
+        const uint32_t colour = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+        if ((Indices[i] >= Palette.size()) || (Palette[Indices[i]] != colour))
+            return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * Write the image to a file, in the format given by the file extension:
+ * '.qoi', '.rgba' for raw RGBA, otherwise png. A quantised image is written
+ * as a palette png, otherwise it is written as RGBA.
+ *
+ * @param  fileName - name of the image file.
+ * @param  level - compression level, 0 to store, 1 for fast RLE, up to 9.
+ * @param  threads - number of threads used to compress the image.
+ * @return error value or 0 if no errors.
+ */
+int image::save(const string & fileName, int level, int threads) const
+{
+    const size_t dot = fileName.rfind('.');
+    const string extension = (dot == string::npos) ? string() : fileName.substr(dot);
+    if ((extension == ".qoi") || (extension == ".rgba"))
+    {
+        vector<uint8_t> buffer(Pixels);
+        unpremultiply(buffer.data(), Width * Height);
+
+        if (extension == ".qoi")
+            return writeQoi(fileName, Width, Height, buffer.data());
+
+        return writeRaw(fileName, Width, Height, buffer.data());
+    }
+
+    if (isQuantised())
+    {
+        vector<uint8_t> colourMap(Palette.size() * 4);
+        for (size_t i = 0; i < Palette.size(); ++i)
+        {
+            colourMap[i * 4]     = Palette[i] >> 24;
+            colourMap[i * 4 + 1] = Palette[i] >> 16;
+            colourMap[i * 4 + 2] = Palette[i] >> 8;
+            colourMap[i * 4 + 3] = Palette[i];
+        }
+        unpremultiply(colourMap.data(), Palette.size());
+
+        return writePng(fileName, Width, Height, 1, Indices.data(), colourMap, level, threads);
+    }
+
+    vector<uint8_t> buffer(Pixels);
+    unpremultiply(buffer.data(), Width * Height);
+
+    return writePng(fileName, Width, Height, 4, buffer.data(), vector<uint8_t>(), level, threads);
+}
+
+
+/**
+ * Set every pixel of the image to the given colour.
+ *
+ * @param  colour - the colour as 0xRRGGBBAA.
+ */
+void image::clear(uint32_t colour)
+{
+    uint8_t pixel[4] = { uint8_t(colour >> 24), uint8_t(colour >> 16), uint8_t(colour >> 8), uint8_t(colour) };
+    premultiply(pixel, 1);
+
+    for (size_t i = 0; i < Pixels.size(); i += 4)
+    {
+        memcpy(&Pixels[i], pixel, 4);
+    }
+}
+
+
+/**
+ * Generate a copy of the image resampled to the requested size using a
+ * separable filter. The rows are resampled first, then the columns.
+ *
+ * @param  w - width of the new image in pixels.
+ * @param  h - height of the new image in pixels.
+ * @param  filter - resampling filter.
+ * @return the resampled image.
+ */
+image image::scale(int w, int h, filterType filter) const
+{
+    image dest(w, h);
+    if ((isEmpty()) || (w <= 0) || (h <= 0))
+    {
+        return dest;
+    }
+
+    static const resampleKernels kernels = selectResampleKernels();
+
+//- Precalculate the source pixels and weights for each destination column and row.
+    const filterWeights columns(Width, w, filter);
+    const filterWeights rows(Height, h, filter);
+
+//- Scale each row horizontally.
+    image across(w, Height);
+    for (int y = 0; y < Height; ++y)
+    {
+        kernels.horizontal(across.getRow(y), getRow(y), w, columns);
+    }
+
+//- Scale each column vertically, keeping the colour channels premultiplied.
+    for (int y = 0; y < h; ++y)
+    {
+        vector<const uint8_t *> src(rows.taps);
+        for (int k = 0; k < rows.taps; ++k)
+        {
+            src[k] = across.getRow(rows.first[y] + k);
+        }
+
+        uint8_t * d = dest.getRow(y);
+        kernels.vertical(d, src.data(), w * 4, &rows.weights[y * rows.taps], rows.taps);
+        for (int x = 0; x < w; ++x, d += 4)
+        {
+            d[0] = min(d[0], d[3]);
+            d[1] = min(d[1], d[3]);
+            d[2] = min(d[2], d[3]);
+        }
+    }
+
+    return dest;
+}
+
+
+/**
+ * Composite an image over this one using the "over" operator. The source is
+ * clipped to the bounds of this image, and each row is drawn by the fastest
+ * kernel that the CPU supports.
+ *
+ * @param  src - image to draw.
+ * @param  x - X position of the top left of the source.
+ * @param  y - Y position of the top left of the source.
+ */
+void image::over(const image & src, int x, int y)
+{
+    over(src, x, y, 0, Height);
+}
+
+
+/**
+ * Composite an image over a band of rows of this one, so that the bands of
+ * an image can be drawn separately.
+ *
+ * @param  src - image to draw.
+ * @param  x - X position of the top left of the source.
+ * @param  y - Y position of the top left of the source.
+ * @param  first - the first row of the band.
+ * @param  last - the row after the last row of the band.
+ */
+void image::over(const image & src, int x, int y, int first, int last)
+{
+    static const overKernel overRow = selectOverKernel();
+
+    const int left   = max(0, x);
+    const int top    = max(max(0, first), y);
+    const int right  = min(Width, x + src.Width);
+    const int bottom = min(min(Height, last), y + src.Height);
+
+    if (left >= right)
+        return;
+
+    for (int row = top; row < bottom; ++row)
+    {
+        overRow(getRow(row) + left * 4, src.getRow(row - y) + (left - x) * 4, right - left);
+    }
+}
+
+
+/**
+ * Reduce the image to the colours of a palette, without dithering. Each
+ * distinct colour is matched once, then found in a small lookup table.
+ *
+ * @param  colours - the palette.
+ */
+void image::quantise(const palette & colours)
+{
+    static const int LOOKUP_BITS = 14;
+
+    vector<uint32_t> keys(1 << LOOKUP_BITS);
+    vector<int16_t> lookup(1 << LOOKUP_BITS, -1);
+
+    Palette.resize(colours.size());
+    for (size_t i = 0; i < colours.size(); ++i)
+    {
+        Palette[i] = colours.getColour(i);
+    }
+
+    Indices.resize(Pixels.size() / 4);
+    uint8_t * p = Pixels.data();
+    for (size_t i = 0; i < Indices.size(); ++i, p += 4)
+    {
+        const uint32_t colour = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+        const uint32_t slot = (colour * 2654435761U) >> (32 - LOOKUP_BITS);
+        if ((lookup[slot] < 0) || (keys[slot] != colour))
+        {
+            keys[slot] = colour;
+            lookup[slot] = colours.nearest(colour);
+        }
+
+        Indices[i] = lookup[slot];
+        const uint32_t match = Palette[Indices[i]];
+        p[0] = match >> 24;
+        p[1] = match >> 16;
+        p[2] = match >> 8;
+        p[3] = match;
+    }
+}
+
+
+/**
+ * Rotate the image through 180 degrees in place.
+ *
+ */
+void image::rotate180(void)
+{
+    uint32_t * p = (uint32_t *)Pixels.data();
+    reverse(p, p + (Width * Height));
+}
+
+
+/**
+ * Draw an antialiased filled rounded rectangle with an outline. The outline
+ * is centred on the edge of the rectangle, as ImageMagick does. Only the
+ * pixels near the outline are calculated, the inside of each row is filled
+ * as a single span.
+ *
+ * @param  x0 - X position of the top left corner.
+ * @param  y0 - Y position of the top left corner.
+ * @param  x1 - X position of the bottom right corner.
+ * @param  y1 - Y position of the bottom right corner.
+ * @param  r - radius of the corners.
+ * @param  fill - fill colour as 0xRRGGBBAA.
+ * @param  stroke - outline colour as 0xRRGGBBAA.
+ * @param  strokeWidth - width of the outline in pixels.
+ */
+void image::roundRectangle(int x0, int y0, int x1, int y1, int r, uint32_t fill, uint32_t stroke, int strokeWidth)
+{
+    static const overKernel overRow = selectOverKernel();
+
+    uint8_t fillPixel[4] = { uint8_t(fill >> 24), uint8_t(fill >> 16), uint8_t(fill >> 8), uint8_t(fill) };
+    uint8_t strokePixel[4] = { uint8_t(stroke >> 24), uint8_t(stroke >> 16), uint8_t(stroke >> 8), uint8_t(stroke) };
+    premultiply(fillPixel, 1);
+    premultiply(strokePixel, 1);
+
+    const float cx = (x0 + x1) / 2.0F;
+    const float cy = (y0 + y1) / 2.0F;
+    const float hx = (x1 - x0) / 2.0F - r;
+    const float hy = (y1 - y0) / 2.0F - r;
+    const float half = strokeWidth / 2.0F;
+
+//- A row of fill pixels, used to fill the inside of each row.
+    vector<uint8_t> fillRow(Width * 4);
+    for (int x = 0; x < Width; ++x)
+    {
+        memcpy(&fillRow[x * 4], fillPixel, 4);
+    }
+
+    const int top    = max(0, int(floorf(y0 - half - 1)));
+    const int bottom = min(Height - 1, int(ceilf(y1 + half + 1)));
+    const int left   = max(0, int(floorf(x0 - half - 1)));
+    const int right  = min(Width - 1, int(ceilf(x1 + half + 1)));
+    const int margin = int(ceilf(half)) + 1;
+
+    for (int y = top; y <= bottom; ++y)
+    {
+        // Find the span of the row that is well inside the outline.
+        int inside = -1;
+        if ((y >= y0 + margin) && (y <= y1 - margin))
+        {
+            inside = (fabsf(y - cy) <= hy) ? margin : r + margin;
+        }
+        const int spanLeft  = (inside < 0) ? right + 1 : max(left, x0 + inside);
+        const int spanRight = (inside < 0) ? right : min(right, x1 - inside);
+
+        uint8_t * row = getRow(y);
+        for (int x = left; x <= right; ++x)
+        {
+            if ((x == spanLeft) && (spanLeft <= spanRight))
+            {
+                overRow(row + x * 4, &fillRow[x * 4], spanRight - spanLeft + 1);
+                x = spanRight;
+                continue;
+            }
+
+            // Signed distance from the pixel centre to the rectangle edge.
+            const float qx = fabsf(x - cx) - hx;
+            const float qy = fabsf(y - cy) - hy;
+            const float outside = hypotf(max(qx, 0.0F), max(qy, 0.0F));
+            const float dist = outside + min(max(qx, qy), 0.0F) - r;
+
+            // Coverage of the whole shape, and of the fill inside the stroke.
+            const float shape = max(0.0F, min(1.0F, half - dist + 0.5F));
+            if (shape == 0.0F)
+                continue;
+
+            const float inner = max(0.0F, min(1.0F, -half - dist + 0.5F));
+            uint8_t src[4];
+            for (int c = 0; c < 4; ++c)
+            {
+                src[c] = uint8_t(fillPixel[c] * inner + strokePixel[c] * (shape - inner) + 0.5F);
+            }
+            overRow(row + x * 4, src, 1);
+        }
+    }
+}
+
+
+/**
+ * Convert a colour name, as used by ImageMagick, into a colour value. Names
+ * may be one of the common colour names or a hex value in the form "#rgb",
+ * "#rrggbb" or "#rrggbbaa".
+ *
+ * @param  name - colour name.
+ * @param  colour - the colour as 0xRRGGBBAA.
+ * @return error value or 0 if no errors.
+ */
+int parseColour(const string & name, uint32_t & colour)
+{
+    string lower(name);
+    transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+
+    if ((lower.length()) && (lower[0] == '#'))
+    {
+        const string hex = lower.substr(1);
+        if (hex.find_first_not_of("0123456789abcdef") != string::npos)
+        {
+            return 1;
+        }
+
+        const uint32_t value = strtoul(hex.c_str(), NULL, 16);
+        switch (hex.length())
+        {
+        case 3:
+            colour = ((value & 0xF00) << 20) | ((value & 0xF00) << 16) |
+                     ((value & 0x0F0) << 16) | ((value & 0x0F0) << 12) |
+                     ((value & 0x00F) << 12) | ((value & 0x00F) << 8) | 0xFF;
+            return 0;
+
+        case 6:
+            colour = (value << 8) | 0xFF;
+            return 0;
+
+        case 8:
+            colour = value;
+            return 0;
+        }
+
+        return 1;
+    }
+
+    for (size_t i = 0; i < ELEMENTS(colourNames); ++i)
+    {
+        if (lower == colourNames[i].name)
+        {
+            colour = colourNames[i].colour;
+
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/**
+ * Look up a resampling filter by name.
+ *
+ * @param  name - filter name.
+ * @param  filter - the filter.
+ * @return error value or 0 if no errors.
+ */
+int parseFilter(const string & name, filterType & filter)
+{
+    for (size_t i = 0; i < ELEMENTS(filterNames); ++i)
+    {
+        if (name == filterNames[i].name)
+        {
+            filter = filterNames[i].filter;
+
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
@@ -0,0 +1,97 @@
+/**
+ * @file    image.h
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ * Interface for the image class.
+ */
+
+#if !defined _IMAGE_H_INCLUDED_
+#define _IMAGE_H_INCLUDED_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class palette;
+
+
+/**
+ * @section filterType enumeration.
+ *
+ * Used to select the filter that resamples an image.
+ */
+enum filterType
+{
+    BOX_FILTER,         // Average of the covered pixels, fastest.
+    BILINEAR_FILTER,    // Linear interpolation, widened when reducing.
+    LANCZOS_FILTER      // 3-lobed Lanczos, sharpest for print.
+};
+
+
+/**
+ * @section image class.
+ *
+ * Used to hold an RGBA image in memory for the native renderer. Pixels are
+ * stored as premultiplied 8-bit RGBA, row by row, with no padding. Once the
+ * image is quantised it also holds the palette index of each pixel, so that
+ * it can be saved as a palette image.
+ */
+class image
+{
+private:
+    int Width;
+    int Height;
+    vector<uint8_t> Pixels;
+    vector<uint8_t> Indices;    // Palette index of each pixel, once quantised.
+    vector<uint32_t> Palette;   // Colours of the palette, once quantised.
+
+public:
+    image(void) : Width(0), Height(0) {}
+    image(int w, int h) : Width(w), Height(h), Pixels(w * h * 4, 0) {}
+
+    int getWidth(void) const { return Width; }
+    int getHeight(void) const { return Height; }
+    bool isEmpty(void) const { return Pixels.empty(); }
+
+    uint8_t * getRow(int y) { return &Pixels[y * Width * 4]; }
+    const uint8_t * getRow(int y) const { return &Pixels[y * Width * 4]; }
+
+    int load(const string & fileName);
+    int save(const string & fileName, int level, int threads) const;
+    bool isQuantised(void) const;
+
+    void clear(uint32_t colour);
+    image scale(int w, int h, filterType filter) const;
+    void over(const image & src, int x, int y);
+    void over(const image & src, int x, int y, int first, int last);
+    void rotate180(void);
+    void quantise(const palette & colours);
+    void roundRectangle(int x0, int y0, int x1, int y1, int r, uint32_t fill, uint32_t stroke, int strokeWidth);
+
+};
+
+extern int parseColour(const string & name, uint32_t & colour);
+extern int parseFilter(const string & name, filterType & filter);
+
+#endif //!defined _IMAGE_H_INCLUDED_
+
@@ -26,8 +26,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <getopt.h>
+#include <unistd.h>
 
 #include "cardgen.h"
+#include "image.h"
+#include "archive.h"
 #include "config.h"
 
 #include <iostream>
@@ -40,6 +43,8 @@
  */
 static void help(const char * const name)
 {
+    const deckConfig defaults;
+
     cout << "Usage: " << name << " [Options]" << endl;
     cout << "  Generates the bash script \"" << scriptFilename << "\" which draws a pack of playing cards."<< endl;
     cout << endl;
@@ -47,32 +52,49 @@ static void help(const char * const name)
     cout << "\t--help \t\t\t\tThis help page and nothing else." << endl;
     cout << "\t-v --version \t\t\tDisplay version." << endl;
     cout << endl;
-    cout << "\t-i --index directory \t\tSubdirectory of indices to use (default: \"" << indexDirectory << "\")." << endl;
-    cout << "\t-p --pip directory \t\tSubdirectory of pips to use (default: \"" << pipDirectory << "\")." << endl;
-    cout << "\t-f --face directory \t\tSubdirectory of faces to use (default: \"" << faceDirectory << "\")." << endl;
+    cout << "\t-i --index directory \t\tSubdirectory of indices to use (default: \"" << defaults.indexDirectory << "\")." << endl;
+    cout << "\t-p --pip directory \t\tSubdirectory of pips to use (default: \"" << defaults.pipDirectory << "\")." << endl;
+    cout << "\t-f --face directory \t\tSubdirectory of faces to use (default: \"" << defaults.faceDirectory << "\")." << endl;
     cout << endl;
     cout << "\t-s --script filename \t\tScript filename (default: \"" << scriptFilename << "\")." << endl;
+    cout << "\t--cache \t\t\tReuse unchanged card images from \"" << cacheDirectory << "\" when used with --render or --jobs." << endl;
+    cout << "\t--no-meta-cache \t\tDon't use or update the image size cache \"" << metadataFilename << "\"." << endl;
+    cout << "\t--batch filename \t\tGenerate every pack listed in the manifest, one line of options per pack." << endl;
+    cout << "\t--makefile filename \t\tGenerate a Makefile with a rule for each card instead of the script." << endl;
+    cout << "\t--magick \t\t\tDraw every card in the script with a single 'magick' process." << endl;
     cout << "\t-o --output directory \t\tOutput filename (default: same directory name as face)." << endl;
-    cout << "\t-w --width integer \t\tCard width in pixels (default: " << cardWidth << ")." << endl;
-    cout << "\t-h --height integer \t\tCard height in pixels (default: " << cardHeight << ")." << endl;
-    cout << "\t-c --colour name \t\tBackground colour name (defined at: http://www.imagemagick.org/script/color.php, default: \"" << cardColour << "\")." << endl;
-    cout << "\t-a --KeepAspectRatio \t\tKeep image Aspect Ratio (default: " << (keepAspectRatio ? "true" : "false") << ")." << endl;
+    cout << "\t-w --width integer \t\tCard width in pixels (default: " << defaults.cardWidth << ")." << endl;
+    cout << "\t-h --height integer \t\tCard height in pixels (default: " << defaults.cardHeight << ")." << endl;
+    cout << "\t-c --colour name \t\tBackground colour name (defined at: http://www.imagemagick.org/script/color.php, default: \"" << defaults.cardColour << "\")." << endl;
+    cout << "\t-a --KeepAspectRatio \t\tKeep image Aspect Ratio (default: " << (defaults.keepAspectRatio ? "true" : "false") << ")." << endl;
+    cout << "\t-r --render \t\t\tRender the card images directly instead of generating the script." << endl;
+    cout << "\t--filter name \t\t\tResampling filter used by --render: box, bilinear or lanczos (default: \"" << filterName << "\")." << endl;
+    cout << "\t--format name \t\t\tCard image format: png, qoi or rgba (raw 8-bit RGBA) (default: \"" << outputFormat << "\")." << endl;
+    cout << "\t--atlas size \t\t\tAlso pack the cards into sheets of at most size x size pixels, with a manifest." << endl;
+    cout << "\t--mips integer \t\t\tNumber of mip levels written for each atlas sheet (default: " << mipLevels << ")." << endl;
+    cout << "\t--image-cache-mb integer \tMegabytes of decoded images kept for reuse by --render (default: " << imageCacheMB << ")." << endl;
+    cout << "\t--no-pixel-cache \t\tDon't use or update the decoded image cache \"" << pixelCacheFilename << "\" used by --render." << endl;
+    cout << "\t--assets filename \t\tRead the asset images from an uncompressed tar or zip file when used with --render." << endl;
+    cout << "\t--stats \t\t\tReport the tasks run and time used by each rendering thread." << endl;
+    cout << "\t--png-level integer \t\tCompression used by --render, 0 to store, 1 for fast RLE, up to 9 for the smallest files (default: " << pngLevel << ")." << endl;
+    cout << "\t--shared-palette \t\tReduce every card to one palette sampled from all the cards when used with --render." << endl;
+    cout << "\t-j --jobs integer \t\tRun the drawing commands directly using up to this many concurrent processes (0 for one per CPU)." << endl;
     cout << endl;
-    cout << "\t--IndexHeight value \t\tHeight of index as a % of card height (default: " << indexInfo.getH() << ")." << endl;
-    cout << "\t--IndexCentreX value \t\tX value of centre of index as a % of card width (default: " << indexInfo.getX() << ")." << endl;
-    cout << "\t--IndexCentreY value \t\tY value of centre of index as a % of card height (default: " << indexInfo.getY() << ")." << endl;
-    cout << "\t--CornerPipHeight value \tHeight of corner pip as a % of card height (default: " << cornerPipInfo.getH() << ")." << endl;
-    cout << "\t--CornerPipCentreX value \tX value of centre of corner pip as a % of card width (default: " << cornerPipInfo.getX() << ")." << endl;
-    cout << "\t--CornerPipCentreY value \tY value of centre of corner pip as a % of card height (default: " << cornerPipInfo.getY() << ")." << endl;
-    cout << "\t--StandardPipHeight value \tHeight of standard pip as a % of card height (default: " << standardPipInfo.getH() << ")." << endl;
-    cout << "\t--StandardPipCentreX value \tX value of centre of standard pip as a % of card width (default: " << standardPipInfo.getX() << ")." << endl;
-    cout << "\t--StandardPipCentreY value \tY value of centre of standard pip as a % of card height (default: " << standardPipInfo.getY() << ")." << endl;
-    cout << "\t--ImageBoarderX value \t\tImage Boarder in X direction as a % of card width (default: " << boarderX << ")." << endl;
-    cout << "\t--ImageBoarderY value \t\tImage Boarder in Y direction as a % of card height (default: " << boarderY << ")." << endl;
+    cout << "\t--IndexHeight value \t\tHeight of index as a % of card height (default: " << defaults.indexInfo.getH() << ")." << endl;
+    cout << "\t--IndexCentreX value \t\tX value of centre of index as a % of card width (default: " << defaults.indexInfo.getX() << ")." << endl;
+    cout << "\t--IndexCentreY value \t\tY value of centre of index as a % of card height (default: " << defaults.indexInfo.getY() << ")." << endl;
+    cout << "\t--CornerPipHeight value \tHeight of corner pip as a % of card height (default: " << defaults.cornerPipInfo.getH() << ")." << endl;
+    cout << "\t--CornerPipCentreX value \tX value of centre of corner pip as a % of card width (default: " << defaults.cornerPipInfo.getX() << ")." << endl;
+    cout << "\t--CornerPipCentreY value \tY value of centre of corner pip as a % of card height (default: " << defaults.cornerPipInfo.getY() << ")." << endl;
+    cout << "\t--StandardPipHeight value \tHeight of standard pip as a % of card height (default: " << defaults.standardPipInfo.getH() << ")." << endl;
+    cout << "\t--StandardPipCentreX value \tX value of centre of standard pip as a % of card width (default: " << defaults.standardPipInfo.getX() << ")." << endl;
+    cout << "\t--StandardPipCentreY value \tY value of centre of standard pip as a % of card height (default: " << defaults.standardPipInfo.getY() << ")." << endl;
+    cout << "\t--ImageBoarderX value \t\tImage Boarder in X direction as a % of card width (default: " << defaults.boarderX << ")." << endl;
+    cout << "\t--ImageBoarderY value \t\tImage Boarder in Y direction as a % of card height (default: " << defaults.boarderY << ")." << endl;
     cout << "\t--ImagePipOff \t\t\tDon't display image pip on the court cards." << endl;
-    cout << "\t--ImagePipHeight value \t\tHeight of image pip as a % of card height (default: " << imagePipInfo.getH() << ")." << endl;
-    cout << "\t--ImagePipCentreX value \tX value of centre of image pip as a % of card width relative to ImageBoarderX (default: " << imagePipInfo.getX() << ")." << endl;
-    cout << "\t--ImagePipCentreY value \tY value of centre of image pip as a % of card height relative to ImageBoarderY (default: " << imagePipInfo.getY() << ")." << endl;
+    cout << "\t--ImagePipHeight value \t\tHeight of image pip as a % of card height (default: " << defaults.imagePipInfo.getH() << ")." << endl;
+    cout << "\t--ImagePipCentreX value \tX value of centre of image pip as a % of card width relative to ImageBoarderX (default: " << defaults.imagePipInfo.getX() << ")." << endl;
+    cout << "\t--ImagePipCentreY value \tY value of centre of image pip as a % of card height relative to ImageBoarderY (default: " << defaults.imagePipInfo.getY() << ")." << endl;
     cout << endl;
     cout << "\t--CentreX value \t\tShortcut for: --IndexCentreX value --CornerPipCentreX value." << endl;
     cout << "\t--Inputs value \t\t\tShortcut for: -f value -p value -i value." << endl;
@@ -91,15 +113,36 @@ static void version(const char * const name)
 }
 
 
+/**
+ * Check if an option only changes the settings of a pack, so it can be used
+ * on a line of a batch manifest.
+ *
+ * @param  optchr - the option value returned by getopt_long().
+ * @return true if the option is a pack setting, false otherwise.
+ */
+static bool isPackOption(int optchr)
+{
+    if ((optchr >= 1) && (optchr <= 17))
+    {
+        return true;
+    }
+
+    return (optchr > 0) && (string("whcipfoa").find(char(optchr)) != string::npos);
+}
+
+
 /**
  * Process command line parameters with help from getopt_long() and update
- * global variables.
+ * the pack settings and global variables. The options of a batch manifest
+ * line may only change the pack settings.
  *
  * @param  argc - command line argument count.
  * @param  argv - command line argument vector.
+ * @param  config - the pack settings to update.
+ * @param  variant - true if the options are from a batch manifest line.
  * @return error value or 0 if no errors.
  */
-static int parseCommandLine(int argc, char *argv[])
+static int parseCommandLine(int argc, char *argv[], deckConfig & config, bool variant)
 {
     while (1)
     {
@@ -119,6 +162,8 @@ static int parseCommandLine(int argc, char *argv[])
             {"output",  required_argument,0,'o'},
             {"help",    no_argument,0,0},
             {"KeepAspectRatio",  no_argument,0,'a'},
+            {"render",  no_argument,0,'r'},
+            {"jobs",    required_argument,0,'j'},
 
             {"IndexHeight", required_argument,0,1},
             {"IndexCentreX", required_argument,0,2},
@@ -141,59 +186,179 @@ static int parseCommandLine(int argc, char *argv[])
 
             {"CentreX", required_argument,0,16},
             {"Inputs", required_argument,0,17},
+            {"makefile", required_argument,0,18},
+            {"cache", no_argument,0,19},
+            {"no-meta-cache", no_argument,0,20},
+            {"batch", required_argument,0,21},
+            {"magick", no_argument,0,22},
+            {"filter", required_argument,0,23},
+            {"shared-palette", no_argument,0,24},
+            {"png-level", required_argument,0,25},
+            {"format", required_argument,0,26},
+            {"atlas", required_argument,0,27},
+            {"mips", required_argument,0,28},
+            {"stats", no_argument,0,29},
+            {"image-cache-mb", required_argument,0,30},
+            {"no-pixel-cache", no_argument,0,31},
+            {"assets", required_argument,0,32},
             {"version", no_argument,0,'v'},
             {0,0,0,0}
         };
 
-        optchr = getopt_long(argc, argv ,"w:h:c:i:p:f:s:o:av", long_options, &option_index);
+        optchr = getopt_long(argc, argv ,"w:h:c:i:p:f:s:o:arj:v", long_options, &option_index);
         if (optchr == -1)
+        {
+            if ((variant) && (optind < argc))
+            {
+                cerr << "Unexpected argument " << argv[optind] << endl;
+
+                return -1;
+            }
+
             return 0;
+        }
+
+        if ((variant) && (optchr != '?') && (!isPackOption(optchr)))
+        {
+            string name = "-" + string(1, char(optchr));
+            for (const struct option * it = long_options; it->name; ++it)
+            {
+                if (it->val == optchr)
+                {
+                    name = string("--") + it->name;
+                    break;
+                }
+            }
+            cerr << "Option " << name << " applies to the whole run, not to one pack" << endl;
+
+            return -1;
+        }
 
         switch (optchr)
         {
-            case 'w': cardWidth = atoi(optarg);             break;
-            case 'h': cardHeight = atoi(optarg);            break;
-            case 'c': cardColour = string(optarg);          break;
+            case 'w': config.cardWidth = atoi(optarg);             break;
+            case 'h': config.cardHeight = atoi(optarg);            break;
+            case 'c': config.cardColour = string(optarg);          break;
 
-            case 'i': indexDirectory = string(optarg);      break;
-            case 'p': pipDirectory = string(optarg);        break;
-            case 'f': faceDirectory = string(optarg);       break;
+            case 'i': config.indexDirectory = string(optarg);      break;
+            case 'p': config.pipDirectory = string(optarg);        break;
+            case 'f': config.faceDirectory = string(optarg);       break;
 
             case 's': scriptFilename = string(optarg);      break;
-            case 'o': outputDirectory = string(optarg);     break;
-
-            case 'a': keepAspectRatio = true;               break;
+            case 'o': config.outputDirectory = string(optarg);     break;
+
+            case 'a': config.keepAspectRatio = true;               break;
+            case 'r': renderImages = true;                  break;
+            case 'j':
+                jobCount = atoi(optarg);
+                if (jobCount < 1)
+                {
+                    jobCount = sysconf(_SC_NPROCESSORS_ONLN);
+                }
+                break;
 
-            case 1:   indexInfo.setH(atof(optarg));         break;
-            case 2:   indexInfo.setX(atof(optarg));         break;
-            case 3:   indexInfo.setY(atof(optarg));         break;
+            case 1:   config.indexInfo.setH(atof(optarg));         break;
+            case 2:   config.indexInfo.setX(atof(optarg));         break;
+            case 3:   config.indexInfo.setY(atof(optarg));         break;
 
-            case 4:   cornerPipInfo.setH(atof(optarg));     break;
-            case 5:   cornerPipInfo.setX(atof(optarg));     break;
-            case 6:   cornerPipInfo.setY(atof(optarg));     break;
+            case 4:   config.cornerPipInfo.setH(atof(optarg));     break;
+            case 5:   config.cornerPipInfo.setX(atof(optarg));     break;
+            case 6:   config.cornerPipInfo.setY(atof(optarg));     break;
 
-            case 7:   standardPipInfo.setH(atof(optarg));   break;
-            case 8:   standardPipInfo.setX(atof(optarg));   break;
-            case 9:   standardPipInfo.setY(atof(optarg));   break;
+            case 7:   config.standardPipInfo.setH(atof(optarg));   break;
+            case 8:   config.standardPipInfo.setX(atof(optarg));   break;
+            case 9:   config.standardPipInfo.setY(atof(optarg));   break;
 
-            case 10:  boarderX = atof(optarg);              break;
-            case 11:  boarderY = atof(optarg);              break;
-            case 12:  imagePipInfo.setH(0);                 break;
-            case 13:  imagePipInfo.setH(atof(optarg));      break;
-            case 14:  imagePipInfo.setX(atof(optarg));      break;
-            case 15:  imagePipInfo.setY(atof(optarg));      break;
+            case 10:  config.boarderX = atof(optarg);              break;
+            case 11:  config.boarderY = atof(optarg);              break;
+            case 12:  config.imagePipInfo.setH(0);                 break;
+            case 13:  config.imagePipInfo.setH(atof(optarg));      break;
+            case 14:  config.imagePipInfo.setX(atof(optarg));      break;
+            case 15:  config.imagePipInfo.setY(atof(optarg));      break;
 
             case 16:
-                indexInfo.setX(atof(optarg));
-                cornerPipInfo.setX(atof(optarg));
+                config.indexInfo.setX(atof(optarg));
+                config.cornerPipInfo.setX(atof(optarg));
                 break;
 
             case 17:
-                indexDirectory = string(optarg);
-                pipDirectory   = string(optarg);
-                faceDirectory  = string(optarg);
+                config.indexDirectory = string(optarg);
+                config.pipDirectory   = string(optarg);
+                config.faceDirectory  = string(optarg);
+                break;
+
+            case 18:  makeFilename = string(optarg);        break;
+            case 19:  useCache = true;                      break;
+            case 20:  metadataFilename.clear();             break;
+            case 21:  batchFilename = string(optarg);       break;
+            case 22:  useMagick = true;                     break;
+            case 23:
+            {
+                filterType filter;
+                if (parseFilter(optarg, filter))
+                {
+                    cerr << "Unknown filter " << optarg << " - aborting!" << endl;
+
+                    return -1;
+                }
+                filterName = string(optarg);
+                break;
+            }
+            case 24:  sharedPalette = true;                 break;
+            case 25:
+                pngLevel = atoi(optarg);
+                if ((pngLevel < 0) || (pngLevel > 9))
+                {
+                    cerr << "PNG level must be from 0 to 9 - aborting!" << endl;
+
+                    return -1;
+                }
                 break;
 
+            case 26:
+                outputFormat = string(optarg);
+                if ((outputFormat != "png") && (outputFormat != "qoi") && (outputFormat != "rgba"))
+                {
+                    cerr << "Unknown format " << optarg << " - aborting!" << endl;
+
+                    return -1;
+                }
+                break;
+
+            case 27:
+                atlasSize = atoi(optarg);
+                if ((atlasSize < 64) || (atlasSize > 16384) || (atlasSize & (atlasSize - 1)))
+                {
+                    cerr << "Atlas size must be a power of two from 64 to 16384 - aborting!" << endl;
+
+                    return -1;
+                }
+                break;
+
+            case 28:
+                mipLevels = atoi(optarg);
+                if ((mipLevels < 0) || (mipLevels > 8))
+                {
+                    cerr << "Mip levels must be from 0 to 8 - aborting!" << endl;
+
+                    return -1;
+                }
+                break;
+
+            case 29:  showStats = true;                     break;
+            case 30:
+                imageCacheMB = atoi(optarg);
+                if (imageCacheMB < 0)
+                {
+                    cerr << "Image cache size can't be negative - aborting!" << endl;
+
+                    return -1;
+                }
+                break;
+
+            case 31:  pixelCacheFilename.clear();           break;
+            case 32:  archiveFilename = string(optarg);     break;
+
             case 'v':
                 version(argv[0]);
 
@@ -216,37 +381,16 @@ static int parseCommandLine(int argc, char *argv[])
 
 
 /**
- * Recalculate global variables using command line input.
+ * Complete the pack settings once all the options have been processed.
  *
+ * @param  config - the pack settings.
  */
-void recalculate(void)
+static void finalise(deckConfig & config)
 {
-//- Card outline values in pixels.
-    radius = ROUND(cornerRadius * cardHeight / 100);
-    outlineWidth = cardWidth-borderOffset-1;
-    outlineHeight = cardHeight-borderOffset-1;
-
-//- Calculate viewport window size as percentages of the card size. In this
-//  context the viewport is the area of the card not occupied by the standard
-//  pip boarders.
-    winPX = (100.0F - (2.0F * standardPipInfo.getX()));
-    winPY = (100.0F - (2.0F * standardPipInfo.getY()));
-
-//- Card face image values in pixels.
-    imageWidth  = 100 - (2 * boarderX);
-    imageHeight = 50 - boarderY;
-    widthPX     = ROUND(imageWidth * cardWidth / 100);
-    heightPX    = ROUND(imageHeight * cardHeight / 100);
-    offsetX     = ROUND(boarderX * cardWidth / 100);
-    offsetY     = ROUND(boarderY * cardHeight / 100);
-
-    imageX      = 50;
-    imageY      = boarderY + (imageHeight / 2);
-
 //- If "outputDirectory" isn't explicitly set, use "face".
-    if (!outputDirectory.length())
+    if (!config.outputDirectory.length())
     {
-        outputDirectory = faceDirectory;
+        config.outputDirectory = config.faceDirectory;
     }
 }
 
@@ -297,22 +441,46 @@ static void dumpValues(void)
 
 
 /**
- * Initialise cardgen using command line input and recalculate global
- * variables.
+ * Initialise cardgen using command line input.
  *
  * @param  argc - command line argument count.
  * @param  argv - command line argument vector.
+ * @param  config - the pack settings to populate.
  * @return error value or 0 if no errors.
  */
-int init(int argc, char *argv[])
+int init(int argc, char *argv[], deckConfig & config)
 {
     int ret = 0;
 
 //- Process command line input.
-    ret = parseCommandLine(argc, argv);
+    config = deckConfig();
+    ret = parseCommandLine(argc, argv, config, false);
     if (!ret)
     {
-        recalculate();
+        finalise(config);
+    }
+
+//- An atlas is packed from the png card images once they are built.
+    if ((!ret) && (atlasSize) && (((!renderImages) && (!jobCount)) || (outputFormat != "png")))
+    {
+        cerr << "An atlas needs png card images built with --render or -j - aborting!" << endl;
+
+        ret = -1;
+    }
+
+//- Only the native renderer can draw from images held in an archive.
+    if ((!ret) && (archiveFilename.length()))
+    {
+        if (!renderImages)
+        {
+            cerr << "Reading assets from an archive needs --render - aborting!" << endl;
+
+            ret = -1;
+        }
+        else if (archiveFiles.open(archiveFilename))
+        {
+            ret = -1;
+        }
     }
 
 #if defined DEBUG
@@ -322,3 +490,115 @@ int init(int argc, char *argv[])
     return ret;
 }
 
+
+/**
+ * Split a line of options into arguments, following the quoting rules of the
+ * shell for quotes, escapes and line continuations.
+ *
+ * @param  command - the line of options.
+ * @return the list of arguments.
+ */
+vector<string> splitOptions(const string & command)
+{
+    vector<string> args;
+    string arg;
+    bool inWord = false;
+
+    for (size_t i = 0; i < command.length(); ++i)
+    {
+        const char c = command[i];
+
+        if (c == '\\')
+        {
+            // Line continuation or escaped character.
+            if (++i < command.length())
+            {
+                if (command[i] != '\n')
+                {
+                    arg += command[i];
+                    inWord = true;
+                }
+            }
+        }
+        else if (c == '\'')
+        {
+            // Everything up to the closing quote is literal.
+            const size_t end = command.find('\'', i + 1);
+            arg += command.substr(i + 1, end - i - 1);
+            i = (end == string::npos) ? command.length() : end;
+            inWord = true;
+        }
+        else if (c == '"')
+        {
+            for (++i; (i < command.length()) && (command[i] != '"'); ++i)
+            {
+                if ((command[i] == '\\') && (i + 1 < command.length()) && (string("\"\\$`\n").find(command[i+1]) != string::npos))
+                {
+                    ++i;
+                }
+                arg += command[i];
+            }
+            inWord = true;
+        }
+        else if ((c == ' ') || (c == '\t') || (c == '\n'))
+        {
+            if (inWord)
+            {
+                args.push_back(arg);
+                arg.clear();
+                inWord = false;
+            }
+        }
+        else
+        {
+            arg += c;
+            inWord = true;
+        }
+    }
+
+    if (inWord)
+    {
+        args.push_back(arg);
+    }
+
+    return args;
+}
+
+
+/**
+ * Initialise the settings for one pack variant of a batch. The settings start
+ * from the defaults, then the command line options are applied, followed by
+ * the variant options, which may only change the pack settings.
+ *
+ * @param  argc - command line argument count.
+ * @param  argv - command line argument vector.
+ * @param  options - the variant options.
+ * @param  config - the pack settings to populate.
+ * @return error value or 0 if no errors.
+ */
+int initVariant(int argc, char *argv[], const vector<string> & options, deckConfig & config)
+{
+    config = deckConfig();
+
+    optind = 0;
+    parseCommandLine(argc, argv, config, false);
+
+//- Build an argument vector for the variant options.
+    vector<char *> args;
+    args.push_back(argv[0]);
+    for (vector<string>::const_iterator it = options.begin(); it != options.end(); ++it)
+    {
+        args.push_back(const_cast<char *>(it->c_str()));
+    }
+    args.push_back(NULL);
+
+    optind = 0;
+    if (parseCommandLine(args.size() - 1, &args[0], config, true))
+    {
+        return 1;
+    }
+
+    finalise(config);
+
+    return 0;
+}
@@ -0,0 +1,207 @@
+/**
+ * @file    magick.cpp
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ * The 'magick' backend. Draws every card with a single ImageMagick process.
+ * Each asset, each scaled copy of an asset and each base layer is prepared once and held in an 'mpr:'
+ * register, then every card is composed from the registers.
+ */
+
+#include <sstream>
+#include <map>
+#include <algorithm>
+#include "cardgen.h"
+#include "assets.h"
+
+
+/**
+ * @section main code.
+ *
+ */
+
+/**
+ * Get the number of steps at the start of a render plan that draw the base
+ * layer of the card. This is at least the canvas and any rounded rectangles.
+ *
+ * @param  card - the card job.
+ * @return the number of steps.
+ */
+static size_t getBaseLength(const job & card)
+{
+    const size_t length = getBlankLength(card.plan);
+    if (!length)
+        return 0;
+
+    return max(length, card.baseLength);
+}
+
+
+/**
+ * Get the suffix added to the register of an asset for a prepared copy.
+ *
+ * @param  op - the image over step.
+ * @return the register suffix.
+ */
+static string getVariant(const drawOp & op)
+{
+    string variant;
+    if (op.prepared)
+        variant = string("s") + to_string(op.w) + "x" + to_string(op.h);
+
+    return op.rotated ? variant + "r" : variant;
+}
+
+
+/**
+ * Convert a sequence of render plan steps to draw the assets from their
+ * registers.
+ *
+ * @param  first - the first step.
+ * @param  last - the step after the last step.
+ * @param  assets - register of each asset.
+ * @return the converted steps.
+ */
+static renderPlan useRegisters(renderPlan::const_iterator first, renderPlan::const_iterator last, const map<string, string> & assets)
+{
+    renderPlan steps;
+
+    for (renderPlan::const_iterator op = first; op != last; ++op)
+    {
+        drawOp step(*op);
+        map<string, string>::const_iterator it = assets.find(op->file);
+        if ((op->type == drawOp::IMAGE_OVER) && (it != assets.end()))
+        {
+            step.file = it->second + getVariant(*op);
+            step.rotated = false;
+            step.prepared = false;
+        }
+        steps.push_back(step);
+    }
+
+    return steps;
+}
+
+
+/**
+ * Generate a single 'magick' command that draws every card in the job list.
+ * The assets are read, and scaled and rotated where needed, into registers,
+ * then the
+ * base layers shared between cards are drawn into registers. Each card then
+ * starts from its base layer, draws the rest of its assets from the
+ * registers and is written out.
+ *
+ * @param  jobs - list of card jobs.
+ * @return the command, one step per line.
+ */
+string genMagickCommand(const vector<job> & jobs)
+{
+    stringstream setup;
+    stringstream cards;
+    map<string, string> bases;          // Register of each base layer.
+    map<string, string> assets;         // Register of each asset.
+    map<string, vector<drawOp> > variants;  // Prepared copies of each asset.
+
+//- Read the assets into the registers.
+    vector<string> assetOrder;
+    for (vector<job>::const_iterator it = jobs.begin(); it != jobs.end(); ++it)
+    {
+        if (!getBaseLength(*it))
+            continue;
+
+        for (renderPlan::const_iterator op = it->plan.begin(); op != it->plan.end(); ++op)
+        {
+            if ((op->type != drawOp::IMAGE_OVER) || (!assetFiles.exists(op->file)))
+                continue;
+
+            string & assetRegister = assets[op->file];
+            if (assetRegister.empty())
+            {
+                assetRegister = string("mpr:asset") + to_string(assets.size() - 1);
+                assetOrder.push_back(op->file);
+            }
+
+            vector<drawOp> & copies = variants[op->file];
+            bool found = false;
+            for (vector<drawOp>::const_iterator copy = copies.begin(); copy != copies.end(); ++copy)
+            {
+                found = found || (getVariant(*copy) == getVariant(*op));
+            }
+            if ((!found) && ((op->rotated) || (op->prepared)))
+            {
+                copies.push_back(*op);
+            }
+        }
+    }
+
+    for (vector<string>::const_iterator file = assetOrder.begin(); file != assetOrder.end(); ++file)
+    {
+        const string & assetRegister = assets[*file];
+        setup << "\t'" << *file << "' -write " << assetRegister << " +delete \\" << endl;
+
+        const vector<drawOp> & copies = variants[*file];
+        for (vector<drawOp>::const_iterator copy = copies.begin(); copy != copies.end(); ++copy)
+        {
+            setup << "\t" << assetRegister;
+            if (copy->prepared)
+                setup << " -resize " << copy->w << "x" << copy->h << "!";
+            if (copy->rotated)
+                setup << " -rotate 180";
+            setup << " -write " << assetRegister << getVariant(*copy) << " +delete \\" << endl;
+        }
+    }
+
+//- Draw the base layers into registers, and the cards from the registers.
+    for (vector<job>::const_iterator it = jobs.begin(); it != jobs.end(); ++it)
+    {
+        const size_t length = getBaseLength(*it);
+        if (!length)
+        {
+            // Not a card, so leave it to the 'convert' backend.
+            continue;
+        }
+
+        const drawOp & canvas = it->plan[0];
+        stringstream base;
+        base << "\t-size " << canvas.w << "x" << canvas.h << " xc:" << canvas.colour << "  \\" << endl;
+        base << genConvertCommand(useRegisters(it->plan.begin() + 1, it->plan.begin() + length, assets));
+
+        string & baseRegister = bases[base.str()];
+        if (baseRegister.empty())
+        {
+            baseRegister = string("mpr:card") + to_string(bases.size() - 1);
+            setup << base.str();
+            setup << "\t-write " << baseRegister << " +delete \\" << endl;
+        }
+
+        const renderPlan draw = useRegisters(it->plan.begin() + length, it->plan.end(), assets);
+        cards << "\t" << baseRegister << " \\" << endl;
+        for (renderPlan::const_iterator op = draw.begin(); op != draw.end(); ++op)
+        {
+            if (op->type == drawOp::WRITE)
+                cards << "\t" << (isRawImage(op->file) ? "-depth 8 " : "") << "-write " << op->file << " +delete \\" << endl;
+            else
+                cards << genConvertCommand(renderPlan(1, *op));
+        }
+    }
+
+    return string("magick \\\n") + setup.str() + cards.str() + "\tnull:\n";
+}
+
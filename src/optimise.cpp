@@ -0,0 +1,190 @@
+/**
+ * @file    optimise.cpp
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ * Render plan optimisation. Rewrites the plan of a card so that it draws the
+ * same image with less work.
+ */
+
+#include <algorithm>
+#include "plan.h"
+#include "assets.h"
+
+
+/**
+ * @section main code.
+ *
+ */
+
+/**
+ * Mirror a step through the centre of the card, so that drawing the mirrored
+ * step gives the same result as rotating the card by 180 degrees, drawing the
+ * step and rotating the card back.
+ *
+ * @param  op - the step to mirror.
+ * @param  width - width of the card in pixels.
+ * @param  height - height of the card in pixels.
+ * @return true if the step was mirrored, false if it can't be.
+ */
+static bool mirror(drawOp & op, int width, int height)
+{
+    int x0 = op.x;
+    int y0 = op.y;
+
+    switch (op.type)
+    {
+    case drawOp::CANVAS:
+        // A plain canvas looks the same either way up.
+        return true;
+
+    case drawOp::ROUND_RECT:
+        // Corners are pixel centres, so x maps to width-1-x.
+        op.x = width - 1 - op.w;
+        op.y = height - 1 - op.h;
+        op.w = width - 1 - x0;
+        op.h = height - 1 - y0;
+        return true;
+
+    case drawOp::IMAGE_OVER:
+        if ((op.w == 0) || (op.h == 0))
+        {
+            // The natural size of the image is needed to find the new origin.
+            if (!assetFiles.getImageSize(op.file, op.w, op.h))
+                return false;
+        }
+
+        op.x = width - op.x - op.w;
+        op.y = height - op.y - op.h;
+        op.rotated = !op.rotated;
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+
+/**
+ * Remove the rotations of the whole card from a render plan. Each step that
+ * would be followed by an odd number of rotations is drawn mirrored instead,
+ * using an asset rotated by 180 degrees, so the final image is unchanged. The
+ * plan is left alone if any of the steps can't be mirrored.
+ *
+ * @param  plan - the render plan of the card.
+ */
+static void removeRotations(renderPlan & plan)
+{
+    if ((plan.empty()) || (plan[0].type != drawOp::CANVAS))
+        return;
+
+    const int width = plan[0].w;
+    const int height = plan[0].h;
+
+    renderPlan optimised;
+    bool flipped = false;   // Is the step followed by an odd number of rotations.
+    for (renderPlan::const_reverse_iterator op = plan.rbegin(); op != plan.rend(); ++op)
+    {
+        if (op->type == drawOp::ROTATE_180)
+        {
+            flipped = !flipped;
+            continue;
+        }
+
+        drawOp step(*op);
+        if ((flipped) && (!mirror(step, width, height)))
+            return;
+
+        optimised.push_back(step);
+    }
+
+    plan.assign(optimised.rbegin(), optimised.rend());
+}
+
+
+/**
+ * Check if two image steps draw over any of the same pixels.
+ *
+ * @param  a - the first image step.
+ * @param  b - the second image step.
+ * @return true if the steps overlap or may overlap, false otherwise.
+ */
+static bool overlaps(const drawOp & a, const drawOp & b)
+{
+    if ((a.type != drawOp::IMAGE_OVER) || (b.type != drawOp::IMAGE_OVER) ||
+        (a.w == 0) || (a.h == 0) || (b.w == 0) || (b.h == 0))
+        return true;
+
+    return (a.x < b.x + b.w) && (b.x < a.x + a.w) && (a.y < b.y + b.h) && (b.y < a.y + a.h);
+}
+
+
+/**
+ * Move the steps that a card shares with other cards to the start of its
+ * render plan, so that they can be drawn once as a base layer for all of the
+ * cards. A step is only moved in front of the steps that it doesn't overlap,
+ * so the final image is unchanged. If any of the shared steps can't be moved
+ * the plan is left alone.
+ *
+ * @param  plan - the optimised render plan of the card.
+ * @param  base - the optimised render plan of the base layer.
+ * @return the number of steps at the start of the plan that are shared.
+ */
+size_t hoistBase(renderPlan & plan, const renderPlan & base)
+{
+//- The blank card is already at the start of the plan.
+    size_t next = 0;
+    while ((next < base.size()) && (next < plan.size()) && (plan[next] == base[next]))
+        ++next;
+
+    const size_t blank = next;
+    renderPlan hoisted(plan);
+    for (size_t i = blank; i < base.size(); ++i)
+    {
+        renderPlan::iterator step = find(hoisted.begin() + next, hoisted.end(), base[i]);
+        if (step == hoisted.end())
+            return blank;
+
+        for (renderPlan::iterator op = hoisted.begin() + next; op != step; ++op)
+        {
+            if (overlaps(*op, *step))
+                return blank;
+        }
+
+        rotate(hoisted.begin() + next, step, step + 1);
+        ++next;
+    }
+
+    plan.swap(hoisted);
+
+    return next;
+}
+
+
+/**
+ * Optimise the render plan of a card.
+ *
+ * @param  plan - the render plan of the card.
+ */
+void optimisePlan(renderPlan & plan)
+{
+    removeRotations(plan);
+}
+
@@ -0,0 +1,188 @@
+/**
+ * @file    over.h
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ *
+ * The "over" compositing kernels of the native renderer, kept apart from
+ * image.cpp so that the benchmark can run each kernel directly.
+ */
+
+#if !defined _OVER_H_INCLUDED_
+#define _OVER_H_INCLUDED_
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined __x86_64__ || defined __i386__
+#include <immintrin.h>
+#define X86_SIMD
+#endif
+
+
+/**
+ * @section "over" compositing kernels.
+ *
+ * Each kernel composites a row of premultiplied RGBA source pixels over a row
+ * of destination pixels. The vector kernels give exactly the same result as
+ * the scalar kernel: for a 16-bit t, (t + 1 + (t >> 8)) >> 8 equals t / 255.
+ */
+
+typedef void (*overKernel)(uint8_t * d, const uint8_t * s, int count);
+
+/**
+ * Composite a row of pixels one pixel at a time.
+ *
+ * @param  d - first destination pixel.
+ * @param  s - first source pixel.
+ * @param  count - number of pixels.
+ */
+static void overRowScalar(uint8_t * d, const uint8_t * s, int count)
+{
+    for (int i = 0; i < count; ++i, s += 4, d += 4)
+    {
+        const int a = s[3];
+        if (a == 255)
+        {
+            memcpy(d, s, 4);
+        }
+        else if (a)
+        {
+            const int inv = 255 - a;
+            d[0] = s[0] + (d[0] * inv + 127) / 255;
+            d[1] = s[1] + (d[1] * inv + 127) / 255;
+            d[2] = s[2] + (d[2] * inv + 127) / 255;
+            d[3] = s[3] + (d[3] * inv + 127) / 255;
+        }
+    }
+}
+
+#if defined X86_SIMD
+/**
+ * Composite 2 pixels held as 16-bit channels.
+ *
+ * @param  s - source channels.
+ * @param  d - destination channels.
+ * @return the composited channels.
+ */
+__attribute__((target("sse2")))
+static inline __m128i over2(__m128i s, __m128i d)
+{
+    const __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xFF), 0xFF);
+    const __m128i inv = _mm_sub_epi16(_mm_set1_epi16(255), a);
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(d, inv), _mm_set1_epi16(127));
+    t = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(t, _mm_set1_epi16(1)), _mm_srli_epi16(t, 8)), 8);
+
+    return _mm_add_epi16(s, t);
+}
+
+
+/**
+ * Composite a row of pixels 4 at a time using SSE2.
+ *
+ * @param  d - first destination pixel.
+ * @param  s - first source pixel.
+ * @param  count - number of pixels.
+ */
+__attribute__((target("sse2")))
+static void overRowSSE2(uint8_t * d, const uint8_t * s, int count)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4, s += 16, d += 16)
+    {
+        const __m128i src = _mm_loadu_si128((const __m128i *)s);
+        const __m128i dst = _mm_loadu_si128((const __m128i *)d);
+        const __m128i lo = over2(_mm_unpacklo_epi8(src, zero), _mm_unpacklo_epi8(dst, zero));
+        const __m128i hi = over2(_mm_unpackhi_epi8(src, zero), _mm_unpackhi_epi8(dst, zero));
+        _mm_storeu_si128((__m128i *)d, _mm_packus_epi16(lo, hi));
+    }
+
+    overRowScalar(d, s, count - i);
+}
+
+
+/**
+ * Composite 4 pixels held as 16-bit channels.
+ *
+ * @param  s - source channels.
+ * @param  d - destination channels.
+ * @return the composited channels.
+ */
+__attribute__((target("avx2")))
+static inline __m256i over4(__m256i s, __m256i d)
+{
+    const __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, 0xFF), 0xFF);
+    const __m256i inv = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+    __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(d, inv), _mm256_set1_epi16(127));
+    t = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(t, _mm256_set1_epi16(1)), _mm256_srli_epi16(t, 8)), 8);
+
+    return _mm256_add_epi16(s, t);
+}
+
+
+/**
+ * Composite a row of pixels 8 at a time using AVX2.
+ *
+ * @param  d - first destination pixel.
+ * @param  s - first source pixel.
+ * @param  count - number of pixels.
+ */
+__attribute__((target("avx2")))
+static void overRowAVX2(uint8_t * d, const uint8_t * s, int count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8, s += 32, d += 32)
+    {
+        const __m256i src = _mm256_loadu_si256((const __m256i *)s);
+        const __m256i dst = _mm256_loadu_si256((const __m256i *)d);
+        const __m256i lo = over4(_mm256_unpacklo_epi8(src, zero), _mm256_unpacklo_epi8(dst, zero));
+        const __m256i hi = over4(_mm256_unpackhi_epi8(src, zero), _mm256_unpackhi_epi8(dst, zero));
+        _mm256_storeu_si256((__m256i *)d, _mm256_packus_epi16(lo, hi));
+    }
+
+    overRowSSE2(d, s, count - i);
+}
+#endif
+
+
+/**
+ * Choose the fastest "over" kernel that the CPU supports.
+ *
+ * @return the kernel.
+ */
+static overKernel selectOverKernel(void)
+{
+#if defined X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return overRowAVX2;
+
+    if (__builtin_cpu_supports("sse2"))
+        return overRowSSE2;
+#endif
+
+    return overRowScalar;
+}
+
+#endif //!defined _OVER_H_INCLUDED_
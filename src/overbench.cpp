@@ -0,0 +1,208 @@
+/**
+ * @file    overbench.cpp
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ * Micro-benchmark of the "over" compositing kernels. Times the scalar kernel
+ * and each vector kernel the CPU supports compositing a whole card sized
+ * image, at the default card size and at 600 dpi print size, and checks
+ * that every kernel gives the same pixels as the scalar kernel.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "over.h"
+
+using namespace std;
+
+
+/**
+ * @section Internal constants and variables.
+ *
+ */
+
+static const double MIN_SECONDS = 0.5;      // Time spent on each kernel and size.
+static const int MIN_RUNS = 3;
+
+static const struct
+{
+    const char * name;
+    int width;
+    int height;
+} sizes[] = {
+    { "380x532", 380, 532 },
+    { "1500x2100 (600 dpi)", 1500, 2100 },
+};
+
+
+/**
+ * @section kernelInfo structure.
+ *
+ * Used to name a kernel and record whether the CPU can run it.
+ */
+struct kernelInfo
+{
+    const char * name;
+    overKernel kernel;
+    bool supported;
+};
+
+
+/**
+ * @section main code.
+ *
+ */
+
+/**
+ * Get the kernels to time, starting with the scalar kernel.
+ *
+ * @return the kernels.
+ */
+static vector<kernelInfo> getKernels(void)
+{
+    vector<kernelInfo> kernels;
+    const kernelInfo scalar = { "scalar", overRowScalar, true };
+    kernels.push_back(scalar);
+
+#if defined X86_SIMD
+    __builtin_cpu_init();
+    const kernelInfo sse2 = { "SSE2", overRowSSE2, bool(__builtin_cpu_supports("sse2")) };
+    const kernelInfo avx2 = { "AVX2", overRowAVX2, bool(__builtin_cpu_supports("avx2")) };
+    kernels.push_back(sse2);
+    kernels.push_back(avx2);
+#endif
+
+    return kernels;
+}
+
+
+/**
+ * Fill an image with premultiplied pixels like those of a face image: about
+ * a third transparent, a third opaque and the rest partly transparent.
+ *
+ * @param  pixels - the image.
+ * @param  seed - starting value of the random numbers.
+ */
+static void fillSource(vector<uint8_t> & pixels, uint32_t seed)
+{
+    for (size_t i = 0; i < pixels.size(); i += 4)
+    {
+        seed = seed * 1664525 + 1013904223;
+        const int choice = (seed >> 8) % 3;
+        const int a = choice == 0 ? 0 : choice == 1 ? 255 : (seed >> 16) & 0xFF;
+        for (int c = 0; c < 3; ++c)
+        {
+            seed = seed * 1664525 + 1013904223;
+            pixels[i + c] = ((seed >> 16) & 0xFF) * a / 255;
+        }
+        pixels[i + 3] = a;
+    }
+}
+
+
+/**
+ * Composite a whole image with a kernel, one row at a time, as the renderer
+ * does.
+ *
+ * @param  kernel - the kernel.
+ * @param  d - the destination image.
+ * @param  s - the source image.
+ * @param  width - width of the images.
+ * @param  height - height of the images.
+ */
+static void overImage(overKernel kernel, uint8_t * d, const uint8_t * s, int width, int height)
+{
+    const size_t stride = size_t(width) * 4;
+    for (int y = 0; y < height; ++y)
+    {
+        kernel(d + y * stride, s + y * stride, width);
+    }
+}
+
+
+/**
+ * System entry point.
+ *
+ * @return error value or 0 if no errors.
+ */
+int main(void)
+{
+    const vector<kernelInfo> kernels = getKernels();
+    const overKernel chosen = selectOverKernel();
+    int failures = 0;
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+        const int width = sizes[i].width;
+        const int height = sizes[i].height;
+        vector<uint8_t> source(size_t(width) * height * 4);
+        vector<uint8_t> background(source.size());
+        fillSource(source, 1);
+        fillSource(background, 2);
+
+        vector<uint8_t> expected(background);
+        overImage(overRowScalar, expected.data(), source.data(), width, height);
+
+        cout << sizes[i].name << ":" << endl;
+        double scalarTime = 0.0;
+        for (vector<kernelInfo>::const_iterator it = kernels.begin(); it != kernels.end(); ++it)
+        {
+            if (!it->supported)
+            {
+                cout << "  " << left << setw(8) << it->name << "not supported by this CPU" << endl;
+                continue;
+            }
+
+//- Check the result against the scalar kernel.
+            vector<uint8_t> pixels(background);
+            overImage(it->kernel, pixels.data(), source.data(), width, height);
+            const bool same = (pixels == expected);
+            if (!same)
+                ++failures;
+
+//- Time whole images until enough time has passed.
+            int runs = 0;
+            double seconds = 0.0;
+            const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            while ((runs < MIN_RUNS) || (seconds < MIN_SECONDS))
+            {
+                overImage(it->kernel, pixels.data(), source.data(), width, height);
+                ++runs;
+                seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            }
+
+            const double ms = seconds * 1000.0 / runs;
+            if (it->kernel == overRowScalar)
+                scalarTime = ms;
+
+            cout << "  " << left << setw(8) << it->name << right << fixed << setprecision(3) << setw(9) << ms << " ms" <<
+                setprecision(1) << setw(7) << scalarTime / ms << "x" << (same ? "" : "  MISMATCH") <<
+                (it->kernel == chosen ? "  (used by --render)" : "") << endl;
+        }
+    }
+
+    return failures ? 1 : 0;
+}
+
@@ -0,0 +1,372 @@
+/**
+ * @file    palette.cpp
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ *
+ * Colour quantiser. Reduces the colours of the card images with median cut,
+ * in place of ImageMagick's "+dither -colors 256".
+ */
+
+#include <algorithm>
+#include "palette.h"
+#include "image.h"
+
+
+/**
+ * @section Internal constants and variables.
+ *
+ */
+
+static const int SAMPLES = 65536;   // Pixels sampled from each image by default.
+
+
+/**
+ * @section main code.
+ *
+ */
+
+/**
+ * Get a channel of a colour.
+ *
+ * @param  colour - the colour as 0xRRGGBBAA.
+ * @param  channel - 0 for red, 1 for green, 2 for blue and 3 for alpha.
+ * @return the channel value.
+ */
+static inline int getChannel(uint32_t colour, int channel)
+{
+    return (colour >> (24 - channel * 8)) & 0xFF;
+}
+
+
+/**
+ * Count the colours of an image, sampling one pixel in every step. A step of
+ * 0 samples about SAMPLES pixels of the image.
+ *
+ * @param  source - the image.
+ * @param  step - distance between sampled pixels.
+ */
+void histogram::add(const image & source, int step)
+{
+    const size_t count = size_t(source.getWidth()) * source.getHeight();
+    if (step <= 0)
+    {
+        step = max<size_t>(1, count / SAMPLES);
+    }
+
+    const uint8_t * p = source.getRow(0);
+    for (size_t i = 0; i < count; i += step)
+    {
+        const uint8_t * q = p + i * 4;
+        ++Counts[(uint32_t(q[0]) << 24) | (uint32_t(q[1]) << 16) | (uint32_t(q[2]) << 8) | q[3]];
+    }
+}
+
+
+/**
+ * Add the counts from another histogram.
+ *
+ * @param  other - the other histogram.
+ */
+void histogram::add(const histogram & other)
+{
+    for (unordered_map<uint32_t, uint32_t>::const_iterator it = other.Counts.begin(); it != other.Counts.end(); ++it)
+    {
+        Counts[it->first] += it->second;
+    }
+}
+
+
+/**
+ * @section median cut.
+ *
+ */
+
+/**
+ * @section colourBox structure.
+ *
+ * Used to hold a range of the colour entries being cut, with the channel
+ * that has the widest spread.
+ */
+struct colourBox
+{
+    size_t first;
+    size_t last;
+    uint64_t count;     // Pixels counted in the box.
+    int channel;        // Channel with the widest spread.
+    int spread;         // Spread of that channel.
+};
+
+typedef pair<uint32_t, uint32_t> colourCount;
+
+
+/**
+ * @section byChannel structure.
+ *
+ * Used to order colour entries by one channel.
+ */
+struct byChannel
+{
+    int channel;
+
+    byChannel(int c) : channel(c) {}
+
+    bool operator()(const colourCount & a, const colourCount & b) const
+    {
+        return getChannel(a.first, channel) < getChannel(b.first, channel);
+    }
+};
+
+
+/**
+ * Measure a box of colour entries.
+ *
+ * @param  entries - the colour entries.
+ * @param  first - the first entry in the box.
+ * @param  last - the entry after the last entry in the box.
+ * @return the box.
+ */
+static colourBox measure(const vector<colourCount> & entries, size_t first, size_t last)
+{
+    colourBox box = { first, last, 0, 0, 0 };
+    int lo[4] = { 255, 255, 255, 255 };
+    int hi[4] = { 0, 0, 0, 0 };
+
+    for (size_t i = first; i < last; ++i)
+    {
+        box.count += entries[i].second;
+        for (int c = 0; c < 4; ++c)
+        {
+            lo[c] = min(lo[c], getChannel(entries[i].first, c));
+            hi[c] = max(hi[c], getChannel(entries[i].first, c));
+        }
+    }
+
+    for (int c = 0; c < 4; ++c)
+    {
+        if (hi[c] - lo[c] > box.spread)
+        {
+            box.spread = hi[c] - lo[c];
+            box.channel = c;
+        }
+    }
+
+    return box;
+}
+
+
+/**
+ * Choose up to the requested number of colours to represent a histogram
+ * using median cut. The box with the widest spread, weighted by the number of
+ * pixels in it, is cut at its median until there are enough boxes, then each
+ * box is represented by its average colour. If the histogram has few enough
+ * colours they are used as they are.
+ *
+ * @param  counts - the histogram.
+ * @param  colours - maximum number of colours, up to 256.
+ */
+palette::palette(const histogram & counts, int colours)
+{
+    colours = max(1, min(colours, 256));
+    vector<colourCount> entries(counts.getCounts().begin(), counts.getCounts().end());
+    sort(entries.begin(), entries.end());   // Independent of the order the colours were counted.
+    if (entries.size() <= size_t(colours))
+    {
+        for (vector<colourCount>::const_iterator it = entries.begin(); it != entries.end(); ++it)
+        {
+            Colours.push_back(it->first);
+        }
+        index();
+
+        return;
+    }
+
+//- Cut the boxes.
+    vector<colourBox> boxes(1, measure(entries, 0, entries.size()));
+    while (boxes.size() < size_t(colours))
+    {
+        size_t widest = 0;
+        double best = 0.0;
+        for (size_t i = 0; i < boxes.size(); ++i)
+        {
+            const double score = double(boxes[i].spread) * boxes[i].count;
+            if ((boxes[i].last - boxes[i].first > 1) && (score > best))
+            {
+                best = score;
+                widest = i;
+            }
+        }
+        if (best == 0.0)
+            break;
+
+        const colourBox box = boxes[widest];
+        sort(entries.begin() + box.first, entries.begin() + box.last, byChannel(box.channel));
+
+        // Cut at the median pixel, leaving at least one entry on each side.
+        size_t cut = box.first;
+        uint64_t below = 0;
+        while ((cut < box.last - 1) && (below + entries[cut].second <= box.count / 2))
+        {
+            below += entries[cut].second;
+            ++cut;
+        }
+        cut = max(cut, box.first + 1);
+
+        boxes[widest] = measure(entries, box.first, cut);
+        boxes.push_back(measure(entries, cut, box.last));
+    }
+
+//- Represent each box by its average colour.
+    for (vector<colourBox>::const_iterator box = boxes.begin(); box != boxes.end(); ++box)
+    {
+        uint64_t sum[4] = { 0, 0, 0, 0 };
+        for (size_t i = box->first; i < box->last; ++i)
+        {
+            for (int c = 0; c < 4; ++c)
+                sum[c] += uint64_t(getChannel(entries[i].first, c)) * entries[i].second;
+        }
+
+        uint32_t colour = 0;
+        for (int c = 0; c < 4; ++c)
+        {
+            colour = (colour << 8) | uint32_t((sum[c] + box->count / 2) / box->count);
+        }
+        Colours.push_back(colour);
+    }
+    index();
+}
+
+
+/**
+ * Get the sum of the channels of a colour.
+ *
+ * @param  colour - the colour as 0xRRGGBBAA.
+ * @return the sum.
+ */
+static inline int getSum(uint32_t colour)
+{
+    return getChannel(colour, 0) + getChannel(colour, 1) + getChannel(colour, 2) + getChannel(colour, 3);
+}
+
+
+/**
+ * Index the colours by the sum of their channels.
+ *
+ */
+void palette::index(void)
+{
+    vector< pair<int, uint8_t> > sums;
+    for (size_t i = 0; i < Colours.size(); ++i)
+    {
+        sums.push_back(make_pair(getSum(Colours[i]), uint8_t(i)));
+    }
+    sort(sums.begin(), sums.end());
+
+    Sums.clear();
+    Order.clear();
+    for (size_t i = 0; i < sums.size(); ++i)
+    {
+        Sums.push_back(sums[i].first);
+        Order.push_back(sums[i].second);
+    }
+}
+
+
+/**
+ * Get the squared distance between two colours.
+ *
+ * @param  a - the first colour.
+ * @param  b - the second colour.
+ * @return the squared distance.
+ */
+static inline int getDistance(uint32_t a, uint32_t b)
+{
+    int distance = 0;
+    for (int c = 0; c < 4; ++c)
+    {
+        const int d = getChannel(a, c) - getChannel(b, c);
+        distance += d * d;
+    }
+
+    return distance;
+}
+
+
+/**
+ * Find the palette colour nearest to a colour. The search starts from the
+ * colours with the closest channel sum and works outwards. A colour whose
+ * sum differs by s is at least s / 2 away, so the search stops once the sum
+ * differs by more than twice the distance of the best match.
+ *
+ * @param  colour - the colour as 0xRRGGBBAA.
+ * @return the index of the nearest palette colour.
+ */
+uint8_t palette::nearest(uint32_t colour) const
+{
+    const int sum = getSum(colour);
+    int up = lower_bound(Sums.begin(), Sums.end(), sum) - Sums.begin();
+    int down = up - 1;
+
+    int best = 0;
+    int bestDistance = INT32_MAX;
+    while ((down >= 0) || (up < int(Sums.size())))
+    {
+        if (up < int(Sums.size()))
+        {
+            const int gap = Sums[up] - sum;
+            if (gap * gap > 4 * int64_t(bestDistance))
+            {
+                up = Sums.size();
+            }
+            else
+            {
+                const int distance = getDistance(colour, Colours[Order[up]]);
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    best = Order[up];
+                }
+                ++up;
+            }
+        }
+
+        if (down >= 0)
+        {
+            const int gap = sum - Sums[down];
+            if (gap * gap > 4 * int64_t(bestDistance))
+            {
+                down = -1;
+            }
+            else
+            {
+                const int distance = getDistance(colour, Colours[Order[down]]);
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    best = Order[down];
+                }
+                --down;
+            }
+        }
+    }
+
+    return uint8_t(best);
+}
+
@@ -0,0 +1,85 @@
+/**
+ * @file    image.h
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ *
+ * Interface for the colour quantiser.
+ */
+
+#if !defined _PALETTE_H_INCLUDED_
+#define _PALETTE_H_INCLUDED_
+
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+
+using namespace std;
+
+class image;
+
+
+/**
+ * @section histogram class.
+ *
+ * Used to count the colours used by one or more images. Colours are held as
+ * premultiplied 0xRRGGBBAA values.
+ */
+class histogram
+{
+private:
+    unordered_map<uint32_t, uint32_t> Counts;
+
+public:
+    void add(const image & source, int step);
+    void add(const histogram & other);
+
+    const unordered_map<uint32_t, uint32_t> & getCounts(void) const { return Counts; }
+};
+
+
+/**
+ * @section palette class.
+ *
+ * Used to hold up to 256 colours chosen by median cut, and to find the
+ * nearest of them to any colour. The colours are also indexed by the sum of
+ * their channels, which limits the search for the nearest colour. Colours are held as premultiplied
+ * 0xRRGGBBAA values.
+ */
+class palette
+{
+private:
+    vector<uint32_t> Colours;
+    vector<int> Sums;           // Sum of the channels, in ascending order.
+    vector<uint8_t> Order;      // Index of the colour with each sum.
+
+    void index(void);
+
+public:
+    palette(void) {}
+    palette(const histogram & counts, int colours);
+
+    size_t size(void) const { return Colours.size(); }
+    uint32_t getColour(size_t index) const { return Colours[index]; }
+    uint8_t nearest(uint32_t colour) const;
+
+};
+
+#endif //!defined _PALETTE_H_INCLUDED_
@@ -0,0 +1,429 @@
+/**
+ * @file    pixelcache.cpp
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ *
+ * File of decoded asset pixels, memory mapped so that a warm run reads the
+ * pixels straight from the page cache instead of decoding the png files.
+ *
+ * The file holds a header, a table of fixed size entries, the file names,
+ * then the premultiplied RGBA pixels of each image starting on a page
+ * boundary. Numbers are in the byte order of the machine that wrote it, and
+ * a file from a machine with the other order fails the version check.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include "pixelcache.h"
+#include "image.h"
+#include "cardgen.h"
+#include "archive.h"
+
+
+/**
+ * @section Internal constants and variables.
+ *
+ */
+
+static const char MAGIC[4] = { 'C', 'G', 'P', 'X' };
+static const uint32_t VERSION = 1;
+static const uint64_t PAGE = 4096;  // Alignment of the pixels of each image.
+
+
+/**
+ * @section fileHeader structure.
+ *
+ * Used to lay out the start of the cache file.
+ */
+struct fileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t count;         // Number of entries.
+    uint32_t reserved;
+    uint64_t names;         // Offset of the file names.
+    uint64_t namesLength;
+};
+
+
+/**
+ * @section fileEntry structure.
+ *
+ * Used to lay out the entry of an image in the cache file.
+ */
+struct fileEntry
+{
+    uint64_t name;          // Offset of the name from the start of the names.
+    uint32_t nameLength;
+    uint32_t width;
+    uint32_t height;
+    uint32_t reserved;
+    uint64_t mtime;         // Modification time of the source file.
+    uint64_t size;          // Size of the source file.
+    uint64_t hash;          // Content hash of the source file.
+    uint64_t pixels;        // Offset of the pixels.
+    uint64_t padding;
+};
+
+
+/**
+ * @section main code.
+ *
+ */
+
+/**
+ * Unmap the cache file and close the spool file.
+ *
+ */
+pixelCache::~pixelCache(void)
+{
+    if (Map)
+    {
+        munmap(Map, MapSize);
+    }
+    if (Spool != -1)
+    {
+        close(Spool);
+    }
+}
+
+
+/**
+ * Map the cache file left by a previous run, if there is one, and index the
+ * images in it. A file that is damaged or from another version is ignored,
+ * and replaced when the cache is saved.
+ *
+ * @param  fileName - name of the cache file.
+ */
+void pixelCache::open(const string & fileName)
+{
+    Name = fileName;
+    const int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return;
+    }
+
+    struct stat info;
+    if ((fstat(fd, &info) == 0) && (size_t(info.st_size) >= sizeof(fileHeader)))
+    {
+        MapSize = info.st_size;
+        Map = mmap(NULL, MapSize, PROT_READ, MAP_SHARED, fd, 0);
+        if (Map == MAP_FAILED)
+        {
+            Map = NULL;
+        }
+    }
+    close(fd);
+    if (!Map)
+    {
+        return;
+    }
+
+//- Check the header.
+    const uint8_t * base = (const uint8_t *)Map;
+    const fileHeader * header = (const fileHeader *)base;
+    const uint64_t table = sizeof(fileHeader) + uint64_t(header->count) * sizeof(fileEntry);
+    if ((memcmp(header->magic, MAGIC, sizeof(MAGIC))) || (header->version != VERSION) ||
+        (table > MapSize) || (header->names < table) || (header->namesLength > MapSize - header->names))
+    {
+        return;
+    }
+
+//- Index the entries that lie within the file.
+    const fileEntry * entries = (const fileEntry *)(base + sizeof(fileHeader));
+    const char * names = (const char *)(base + header->names);
+    for (uint32_t i = 0; i < header->count; ++i)
+    {
+        const fileEntry & e = entries[i];
+        const uint64_t bytes = uint64_t(e.width) * e.height * 4;
+        if ((e.name + e.nameLength > header->namesLength) || (e.pixels > MapSize) || (bytes > MapSize - e.pixels))
+        {
+            continue;
+        }
+
+        entry & found = Entries[string(names + e.name, e.nameLength)];
+        found.MTime = e.mtime;
+        found.Size = e.size;
+        found.Hash = e.hash;
+        found.Width = e.width;
+        found.Height = e.height;
+        found.Pixels = base + e.pixels;
+    }
+}
+
+
+/**
+ * Get the pixels of an image file from the cache, if the cache holds the
+ * current version of the file.
+ *
+ * @param  fileName - name of the image file.
+ * @param  info - status of the image file.
+ * @param  pixels - returns the image.
+ * @return true if the image was found, false otherwise.
+ */
+bool pixelCache::find(const string & fileName, const struct stat & info, image & pixels)
+{
+    map<string, entry>::const_iterator it = Entries.find(fileName);
+    if (it == Entries.end())
+    {
+        return false;
+    }
+
+    const entry & e = it->second;
+    if ((e.MTime != info.st_mtime) || (e.Size != info.st_size) || (e.Hash != hashFile(fileName)))
+    {
+        return false;
+    }
+
+    pixels = image(e.Width, e.Height);
+    if (!pixels.isEmpty())
+    {
+        memcpy(pixels.getRow(0), e.Pixels, size_t(e.Width) * e.Height * 4);
+    }
+
+    return true;
+}
+
+
+/**
+ * Add a decoded image, to be written when the cache is saved. The pixels
+ * are written to the spool file straight away, so the caller's image can be
+ * dropped. The image is left out if the spool file can't be written.
+ *
+ * @param  fileName - name of the image file.
+ * @param  info - status of the image file.
+ * @param  pixels - the decoded image.
+ */
+void pixelCache::add(const string & fileName, const struct stat & info, const image & pixels)
+{
+    if ((pixels.isEmpty()) || (Name.empty()))
+    {
+        return;
+    }
+
+    const uint64_t hash = hashFile(fileName);
+    const size_t bytes = size_t(pixels.getWidth()) * pixels.getHeight() * 4;
+
+//- Reserve space in the spool file, creating it if needed.
+    uint64_t offset;
+    {
+        lock_guard<mutex> guard(Lock);
+        if (Added.count(fileName))
+        {
+            return;
+        }
+        if (Spool == -1)
+        {
+            const string spoolName = Name + ".spool" + to_string(getpid());
+            Spool = ::open(spoolName.c_str(), O_RDWR|O_CREAT|O_TRUNC, 0600);
+            if (Spool == -1)
+            {
+                return;
+            }
+            unlink(spoolName.c_str());
+        }
+        offset = SpoolSize;
+        SpoolSize += bytes;
+    }
+
+//- Write the pixels without the lock.
+    const uint8_t * p = pixels.getRow(0);
+    for (size_t done = 0; done < bytes; )
+    {
+        const ssize_t written = pwrite(Spool, p + done, bytes - done, offset + done);
+        if (written <= 0)
+        {
+            return;
+        }
+        done += written;
+    }
+
+    lock_guard<mutex> guard(Lock);
+    if (Added.count(fileName))
+    {
+        return;
+    }
+    added & a = Added[fileName];
+    a.MTime = info.st_mtime;
+    a.Size = info.st_size;
+    a.Hash = hash;
+    a.Width = pixels.getWidth();
+    a.Height = pixels.getHeight();
+    a.Offset = offset;
+}
+
+
+/**
+ * Copy a block of the spool file to a stream.
+ *
+ * @param  spool - the spool file descriptor.
+ * @param  offset - offset of the block.
+ * @param  bytes - length of the block.
+ * @param  stream - the stream to write to.
+ * @return error value or 0 if no errors.
+ */
+static int copySpool(int spool, uint64_t offset, uint64_t bytes, ofstream & stream)
+{
+    char buffer[65536];
+    while (bytes)
+    {
+        const ssize_t got = pread(spool, buffer, min(bytes, uint64_t(sizeof(buffer))), offset);
+        if (got <= 0)
+        {
+            return 1;
+        }
+        stream.write(buffer, got);
+        offset += got;
+        bytes -= got;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Round an offset up to the next page.
+ *
+ * @param  offset - the offset.
+ * @return the aligned offset.
+ */
+static uint64_t alignPage(uint64_t offset)
+{
+    return (offset + PAGE - 1) & ~(PAGE - 1);
+}
+
+
+/**
+ * Write the cache file for the next run, but only if images were decoded.
+ * The images of the previous file are kept while their source files are
+ * unchanged. The file is written to a temporary file first and renamed, so
+ * other runs that have the old file mapped keep their pages, and no run
+ * sees a partial file.
+ *
+ * @param  fileName - name of the cache file.
+ * @return error value or 0 if no errors.
+ */
+int pixelCache::save(const string & fileName)
+{
+    lock_guard<mutex> guard(Lock);
+    if (Added.empty())
+    {
+        return 0;
+    }
+
+//- Lay out the entries, the new images first. The source of a new image is
+//  its offset in the spool file, and of an old one its mapped pixels.
+    vector<fileEntry> entries;
+    vector<const uint8_t *> sources;
+    vector<uint64_t> spooled;
+    string names;
+    for (map<string, added>::const_iterator it = Added.begin(); it != Added.end(); ++it)
+    {
+        const added & a = it->second;
+        fileEntry e = { names.length(), uint32_t(it->first.length()), uint32_t(a.Width),
+            uint32_t(a.Height), 0, uint64_t(a.MTime), uint64_t(a.Size), a.Hash, 0, 0 };
+        names += it->first;
+        entries.push_back(e);
+        sources.push_back(NULL);
+        spooled.push_back(a.Offset);
+    }
+
+    for (map<string, entry>::const_iterator it = Entries.begin(); it != Entries.end(); ++it)
+    {
+        const entry & old = it->second;
+        struct stat info;
+        if ((Added.count(it->first)) || (!old.Width) || (!old.Height) || (archiveFiles.getStatus(it->first, info)) ||
+            (info.st_mtime != old.MTime) || (info.st_size != old.Size))
+            continue;
+
+        fileEntry e = { names.length(), uint32_t(it->first.length()), uint32_t(old.Width),
+            uint32_t(old.Height), 0, uint64_t(old.MTime), uint64_t(old.Size), old.Hash, 0, 0 };
+        names += it->first;
+        entries.push_back(e);
+        sources.push_back(old.Pixels);
+        spooled.push_back(0);
+    }
+
+    fileHeader header;
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.count = entries.size();
+    header.reserved = 0;
+    header.names = sizeof(fileHeader) + entries.size() * sizeof(fileEntry);
+    header.namesLength = names.length();
+
+    uint64_t offset = header.names + header.namesLength;
+    for (vector<fileEntry>::iterator it = entries.begin(); it != entries.end(); ++it)
+    {
+        offset = alignPage(offset);
+        it->pixels = offset;
+        offset += uint64_t(it->width) * it->height * 4;
+    }
+
+//- Write the file.
+    const string temporary = fileName + ".tmp" + to_string(getpid());
+    ofstream stream(temporary, ofstream::out|ofstream::binary|ofstream::trunc);
+    stream.write((const char *)&header, sizeof(header));
+    if (entries.size())
+    {
+        stream.write((const char *)&entries[0], entries.size() * sizeof(fileEntry));
+    }
+    stream.write(names.data(), names.length());
+
+    static const char zeros[PAGE] = { 0 };
+    int ret = 0;
+    for (size_t i = 0; (i < entries.size()) && (!ret); ++i)
+    {
+        const uint64_t bytes = uint64_t(entries[i].width) * entries[i].height * 4;
+        stream.write(zeros, entries[i].pixels - stream.tellp());
+        if (sources[i])
+            stream.write((const char *)sources[i], bytes);
+        else
+            ret = copySpool(Spool, spooled[i], bytes, stream);
+    }
+    stream.close();
+
+    if ((ret) || (!stream) || (rename(temporary.c_str(), fileName.c_str())))
+    {
+        remove(temporary.c_str());
+        cerr << "Error: unable to write pixel cache " << fileName << endl;
+
+        return 1;
+    }
+    Added.clear();
+    SpoolSize = 0;
+    if (ftruncate(Spool, 0))
+    {
+        close(Spool);
+        Spool = -1;
+    }
+
+    return 0;
+}
+
@@ -0,0 +1,94 @@
+/**
+ * @file    pixelcache.h
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ *
+ * Interface for the file of decoded asset pixels kept between runs.
+ */
+
+#if !defined _PIXELCACHE_H_INCLUDED_
+#define _PIXELCACHE_H_INCLUDED_
+
+#include <stdint.h>
+#include <string>
+#include <map>
+#include <mutex>
+#include <sys/stat.h>
+
+using namespace std;
+
+class image;
+
+
+/**
+ * @section pixelCache class.
+ *
+ * Used to keep the decoded pixels of the asset images between runs, so that
+ * a warm run doesn't decode any png files. The cache file is mapped into
+ * memory, and an image is only used if its file has the same modification
+ * time, size and content hash as when it was decoded. The pixels of images
+ * decoded during the run are written to an unlinked spool file as they are
+ * added, so the cache holds no decoded images in memory, and are copied into
+ * the cache file when it is saved.
+ */
+class pixelCache
+{
+private:
+    struct entry
+    {
+        long long MTime;
+        long long Size;
+        uint64_t Hash;
+        int Width;
+        int Height;
+        const uint8_t * Pixels;     // Premultiplied RGBA, in the mapped file.
+    };
+
+    struct added
+    {
+        long long MTime;
+        long long Size;
+        uint64_t Hash;
+        int Width;
+        int Height;
+        uint64_t Offset;            // Offset of the pixels in the spool file.
+    };
+
+    mutex Lock;
+    void * Map;                     // The mapped cache file, or NULL.
+    size_t MapSize;
+    map<string, entry> Entries;     // Images in the cache file.
+    map<string, added> Added;       // Images decoded during the run.
+    string Name;                    // Name of the cache file.
+    int Spool;                      // Spool file descriptor, or -1.
+    uint64_t SpoolSize;
+
+public:
+    pixelCache(void) : Map(NULL), MapSize(0), Spool(-1), SpoolSize(0) {}
+    ~pixelCache(void);
+
+    void open(const string & fileName);
+    bool find(const string & fileName, const struct stat & info, image & pixels);
+    void add(const string & fileName, const struct stat & info, const image & pixels);
+    int save(const string & fileName);
+};
+
+#endif //!defined _PIXELCACHE_H_INCLUDED_
@@ -0,0 +1,427 @@
+/**
+ * @file    plan.cpp
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ * Render plan construction and the 'convert' backend, which turns a plan
+ * into the ImageMagick command for the card.
+ */
+
+#include <sstream>
+#include <algorithm>
+#include "plan.h"
+
+
+/**
+ * @section Internal constants and variables.
+ *
+ */
+
+static const string rotatedDirectory("cards/.rotated/");  // Rotated assets for 'convert'.
+static const string scaledDirectory("cards/.scaled/");    // Scaled assets for 'convert'.
+
+
+/**
+ * @section render plan steps.
+ *
+ */
+
+/**
+ * Create a step that starts a new card.
+ *
+ * @param  w - width of the card in pixels.
+ * @param  h - height of the card in pixels.
+ * @param  colour - background colour name.
+ * @return the step.
+ */
+drawOp canvasOp(int w, int h, const string & colour)
+{
+    drawOp op(drawOp::CANVAS);
+    op.w = w;
+    op.h = h;
+    op.colour = colour;
+
+    return op;
+}
+
+
+/**
+ * Create a step that starts from an existing image.
+ *
+ * @param  file - name of the image file.
+ * @return the step.
+ */
+drawOp loadOp(const string & file)
+{
+    drawOp op(drawOp::LOAD);
+    op.file = file;
+
+    return op;
+}
+
+
+/**
+ * Create a step that draws a rounded rectangle.
+ *
+ * @param  x0 - X value of the top left corner.
+ * @param  y0 - Y value of the top left corner.
+ * @param  x1 - X value of the bottom right corner.
+ * @param  y1 - Y value of the bottom right corner.
+ * @param  radius - corner radius in pixels.
+ * @param  fill - fill colour name.
+ * @param  stroke - stroke colour name.
+ * @param  strokeWidth - stroke width in pixels.
+ * @return the step.
+ */
+drawOp roundRectOp(int x0, int y0, int x1, int y1, int radius, const string & fill, const string & stroke, int strokeWidth)
+{
+    drawOp op(drawOp::ROUND_RECT);
+    op.x = x0;
+    op.y = y0;
+    op.w = x1;
+    op.h = y1;
+    op.radius = radius;
+    op.colour = fill;
+    op.stroke = stroke;
+    op.strokeWidth = strokeWidth;
+
+    return op;
+}
+
+
+/**
+ * Create a step that composites an image file over the card.
+ *
+ * @param  x - X value of the image origin.
+ * @param  y - Y value of the image origin.
+ * @param  w - width to scale the image to, 0 for the natural size.
+ * @param  h - height to scale the image to, 0 for the natural size.
+ * @param  file - name of the image file.
+ * @return the step.
+ */
+drawOp imageOverOp(int x, int y, int w, int h, const string & file)
+{
+    drawOp op(drawOp::IMAGE_OVER);
+    op.x = x;
+    op.y = y;
+    op.w = w;
+    op.h = h;
+    op.file = file;
+
+    return op;
+}
+
+
+/**
+ * Create a step that rotates the card by 180 degrees.
+ *
+ * @return the step.
+ */
+drawOp rotateOp(void)
+{
+    return drawOp(drawOp::ROTATE_180);
+}
+
+
+/**
+ * Create a step that scales the whole image, ignoring the aspect ratio.
+ *
+ * @param  w - width to scale the image to.
+ * @param  h - height to scale the image to.
+ * @return the step.
+ */
+drawOp resizeOp(int w, int h)
+{
+    drawOp op(drawOp::RESIZE);
+    op.w = w;
+    op.h = h;
+
+    return op;
+}
+
+
+/**
+ * Create a step that reduces the number of colours in the card, without
+ * dithering.
+ *
+ * @param  colours - maximum number of colours.
+ * @return the step.
+ */
+drawOp quantizeOp(int colours)
+{
+    drawOp op(drawOp::QUANTIZE);
+    op.colours = colours;
+
+    return op;
+}
+
+
+/**
+ * Create a step that writes the card to an image file.
+ *
+ * @param  file - name of the card image file.
+ * @return the step.
+ */
+drawOp writeOp(const string & file)
+{
+    drawOp op(drawOp::WRITE);
+    op.file = file;
+
+    return op;
+}
+
+
+/**
+ * Get the number of steps at the start of a render plan that draw the blank
+ * card, which is the canvas and any rounded rectangles.
+ *
+ * @param  plan - the render plan of the card.
+ * @return the number of steps, 0 if the plan doesn't start with a canvas.
+ */
+size_t getBlankLength(const renderPlan & plan)
+{
+    if ((plan.empty()) || (plan[0].type != drawOp::CANVAS))
+        return 0;
+
+    size_t length = 1;
+    while ((length < plan.size()) && (plan[length].type == drawOp::ROUND_RECT))
+        ++length;
+
+    return length;
+}
+
+
+/**
+ * @section convert backend.
+ *
+ */
+
+/**
+ * Check if an image file holds raw 8-bit RGBA pixels, with no header.
+ *
+ * @param  file - name of the image file.
+ * @return true if the file is raw RGBA, false otherwise.
+ */
+bool isRawImage(const string & file)
+{
+    const string extension(".rgba");
+
+    return (file.length() > extension.length()) && (file.compare(file.length() - extension.length(), extension.length(), extension) == 0);
+}
+
+
+/**
+ * Check if an image over step draws from a prepared copy of the asset.
+ *
+ * @param  op - the image over step.
+ * @return true if the asset is prepared, false if it is drawn directly.
+ */
+static bool isPrepared(const drawOp & op)
+{
+    return (op.type == drawOp::IMAGE_OVER) && ((op.rotated) || (op.prepared));
+}
+
+
+/**
+ * Get the name of the prepared image file that holds an asset scaled and/or
+ * rotated by 180 degrees, for use by 'convert'.
+ *
+ * @param  op - the image over step.
+ * @return the name of the prepared image file.
+ */
+string getPreparedName(const drawOp & op)
+{
+    const string directory = op.rotated ? rotatedDirectory : scaledDirectory;
+    if (!op.prepared)
+        return directory + op.file;
+
+    return directory + to_string(op.w) + "x" + to_string(op.h) + "/" + op.file;
+}
+
+
+/**
+ * Get the prepared image files needed to draw a card with 'convert'.
+ *
+ * @param  plan - the render plan of the card.
+ * @return the list of prepared image files, without duplicates.
+ */
+vector<string> getPreparedFiles(const renderPlan & plan)
+{
+    vector<string> files;
+
+    for (renderPlan::const_iterator op = plan.begin(); op != plan.end(); ++op)
+    {
+        if (isPrepared(*op))
+        {
+            const string file = getPreparedName(*op);
+            if (find(files.begin(), files.end(), file) == files.end())
+                files.push_back(file);
+        }
+    }
+
+    return files;
+}
+
+
+/**
+ * Get the name of the image file drawn by an image over step.
+ *
+ * @param  op - the image over step.
+ * @return the name of the image file.
+ */
+static string getImageName(const drawOp & op)
+{
+    return isPrepared(op) ? getPreparedName(op) : op.file;
+}
+
+
+/**
+ * Generate the 'convert' command for a card, as written to the script.
+ *
+ * @param  plan - the render plan of the card.
+ * @return the command, one step per line.
+ */
+string genConvertCommand(const renderPlan & plan)
+{
+    stringstream outputStream;
+
+    for (renderPlan::const_iterator op = plan.begin(); op != plan.end(); ++op)
+    {
+        switch (op->type)
+        {
+        case drawOp::CANVAS:
+            outputStream << "convert -size " << op->w << "x" << op->h << " xc:" << op->colour << "  \\" << endl;
+            break;
+
+        case drawOp::LOAD:
+            outputStream << "convert '" << op->file << "' \\" << endl;
+            break;
+
+        case drawOp::ROUND_RECT:
+            outputStream << "\t-fill '" << op->colour << "' -stroke " << op->stroke << " -strokewidth " << op->strokeWidth << " -draw 'roundRectangle " << op->x << ',' << op->y << ' ' << op->w << ',' << op->h << ' ' << op->radius << ',' << op->radius << "' \\" << endl;
+            break;
+
+        case drawOp::IMAGE_OVER:
+            outputStream << "\t-draw \"image over " << op->x << ',' << op->y << ' ' << op->w << ',' << op->h << " '" << getImageName(*op) << "'\" \\" << endl;
+            break;
+
+        case drawOp::ROTATE_180:
+            outputStream << "\t-rotate 180 \\" << endl;
+            break;
+
+        case drawOp::RESIZE:
+            outputStream << "\t-resize " << op->w << "x" << op->h << "! \\" << endl;
+            break;
+
+        case drawOp::QUANTIZE:
+            outputStream << "\t+dither -colors " << op->colours << " \\" << endl;
+            break;
+
+        case drawOp::WRITE:
+            if (isRawImage(op->file))
+                outputStream << "\t-depth 8 \\" << endl;
+            outputStream << "\t" << op->file << endl;
+            break;
+        }
+    }
+
+    return outputStream.str();
+}
+
+
+/**
+ * Generate the argument vector of the 'convert' command for a card, so that
+ * it can be run without a shell.
+ *
+ * @param  plan - the render plan of the card.
+ * @return the list of arguments.
+ */
+vector<string> genConvertArgs(const renderPlan & plan)
+{
+    vector<string> args;
+
+    for (renderPlan::const_iterator op = plan.begin(); op != plan.end(); ++op)
+    {
+        stringstream value;
+
+        switch (op->type)
+        {
+        case drawOp::CANVAS:
+            value << op->w << "x" << op->h;
+            args.push_back("convert");
+            args.push_back("-size");
+            args.push_back(value.str());
+            args.push_back("xc:" + op->colour);
+            break;
+
+        case drawOp::LOAD:
+            args.push_back("convert");
+            args.push_back(op->file);
+            break;
+
+        case drawOp::ROUND_RECT:
+            value << "roundRectangle " << op->x << ',' << op->y << ' ' << op->w << ',' << op->h << ' ' << op->radius << ',' << op->radius;
+            args.push_back("-fill");
+            args.push_back(op->colour);
+            args.push_back("-stroke");
+            args.push_back(op->stroke);
+            args.push_back("-strokewidth");
+            args.push_back(to_string(op->strokeWidth));
+            args.push_back("-draw");
+            args.push_back(value.str());
+            break;
+
+        case drawOp::IMAGE_OVER:
+            value << "image over " << op->x << ',' << op->y << ' ' << op->w << ',' << op->h << " '" << getImageName(*op) << "'";
+            args.push_back("-draw");
+            args.push_back(value.str());
+            break;
+
+        case drawOp::ROTATE_180:
+            args.push_back("-rotate");
+            args.push_back("180");
+            break;
+
+        case drawOp::RESIZE:
+            value << op->w << "x" << op->h << "!";
+            args.push_back("-resize");
+            args.push_back(value.str());
+            break;
+
+        case drawOp::QUANTIZE:
+            args.push_back("+dither");
+            args.push_back("-colors");
+            args.push_back(to_string(op->colours));
+            break;
+
+        case drawOp::WRITE:
+            if (isRawImage(op->file))
+            {
+                args.push_back("-depth");
+                args.push_back("8");
+            }
+            args.push_back(op->file);
+            break;
+        }
+    }
+
+    return args;
+}
+
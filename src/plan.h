@@ -0,0 +1,103 @@
+/**
+ * @file    plan.h
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ * Interface for the render plan of a card.
+ */
+
+#if !defined _PLAN_H_INCLUDED_
+#define _PLAN_H_INCLUDED_
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+/**
+ * @section drawOp structure.
+ *
+ * Used to capture a single step in drawing a card. The list of steps for a
+ * card is its render plan, which each backend turns into drawing commands or
+ * pixels. Which fields are used depends on the type of the step.
+ */
+struct drawOp
+{
+    enum opType
+    {
+        CANVAS,         // Start a new card of size w x h filled with colour.
+        LOAD,           // Start from the image in file.
+        ROUND_RECT,     // Rounded rectangle from x,y to w,h with radius.
+        IMAGE_OVER,     // Asset file composited at x,y scaled to w x h, and
+                        // rotated by 180 degrees if rotated is set. Drawn
+                        // from a copy scaled once if prepared is set.
+        ROTATE_180,     // Rotate the whole card by 180 degrees.
+        RESIZE,         // Scale the whole image to w x h.
+        QUANTIZE,       // Reduce the card to colours colours.
+        WRITE           // Write the card to file.
+    };
+
+    opType type;
+    int x;
+    int y;
+    int w;
+    int h;
+    int radius;
+    int strokeWidth;
+    int colours;
+    bool rotated;
+    bool prepared;
+    string colour;      // Canvas or fill colour.
+    string stroke;      // Stroke colour.
+    string file;        // Asset or card image file name.
+
+    drawOp(opType t) : type(t), x(0), y(0), w(0), h(0), radius(0), strokeWidth(0), colours(0), rotated(false), prepared(false) {}
+
+    bool operator==(const drawOp & a) const
+    {
+        return (type == a.type) && (x == a.x) && (y == a.y) && (w == a.w) && (h == a.h) &&
+            (radius == a.radius) && (strokeWidth == a.strokeWidth) && (colours == a.colours) &&
+            (rotated == a.rotated) && (prepared == a.prepared) && (colour == a.colour) && (stroke == a.stroke) && (file == a.file);
+    }
+};
+
+typedef vector<drawOp> renderPlan;
+
+extern drawOp canvasOp(int w, int h, const string & colour);
+extern drawOp loadOp(const string & file);
+extern drawOp roundRectOp(int x0, int y0, int x1, int y1, int radius, const string & fill, const string & stroke, int strokeWidth);
+extern drawOp imageOverOp(int x, int y, int w, int h, const string & file);
+extern drawOp rotateOp(void);
+extern drawOp resizeOp(int w, int h);
+extern drawOp quantizeOp(int colours);
+extern drawOp writeOp(const string & file);
+
+extern size_t getBlankLength(const renderPlan & plan);
+extern void optimisePlan(renderPlan & plan);
+extern size_t hoistBase(renderPlan & plan, const renderPlan & base);
+
+extern bool isRawImage(const string & file);
+extern string getPreparedName(const drawOp & op);
+extern vector<string> getPreparedFiles(const renderPlan & plan);
+extern string genConvertCommand(const renderPlan & plan);
+extern vector<string> genConvertArgs(const renderPlan & plan);
+
+#endif //!defined _PLAN_H_INCLUDED_
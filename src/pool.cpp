@@ -0,0 +1,146 @@
+/**
+ * @file    pool.cpp
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ *
+ * Pool of decoded images, shared by reference counted handles and kept
+ * within a memory budget.
+ */
+
+#include <sys/stat.h>
+#include "pool.h"
+#include "image.h"
+#include "pixelcache.h"
+#include "archive.h"
+
+
+/**
+ * @section main code.
+ *
+ */
+
+/**
+ * Drop the least recently used images that are not held by anyone else
+ * until the pool is within its budget. Called with the lock held.
+ *
+ */
+void imagePool::evict(void)
+{
+    list<string>::iterator it = Recent.end();
+    while ((Used > Budget) && (it != Recent.begin()))
+    {
+        --it;
+        map<string, entry>::iterator found = Entries.find(*it);
+        if (found->second.pixels.use_count() > 1)
+            continue;
+
+        Used -= found->second.bytes;
+        Entries.erase(found);
+        it = Recent.erase(it);
+    }
+}
+
+
+/**
+ * Drop the images that are over budget once their users have let them go.
+ *
+ */
+void imagePool::trim(void)
+{
+    lock_guard<mutex> guard(Lock);
+    evict();
+}
+
+
+/**
+ * Get a handle to the decoded image of a file, decoding it only if neither
+ * the pool nor the pixel cache hold the current version of the file.
+ *
+ * @param  fileName - name of the image file.
+ * @param  handle - returns the handle, to an empty image if the file can't
+ *                  be read.
+ * @return error value or 0 if no errors.
+ */
+int imagePool::get(const string & fileName, imageHandle & handle)
+{
+    struct stat info;
+    if (archiveFiles.getStatus(fileName, info))
+    {
+        handle = imageHandle(new image());
+
+        return 1;
+    }
+    const string key = fileName + " " + to_string(info.st_mtime) + " " + to_string(info.st_size);
+
+//- Use the image if it is held.
+    {
+        lock_guard<mutex> guard(Lock);
+        map<string, entry>::iterator it = Entries.find(key);
+        if (it != Entries.end())
+        {
+            Recent.splice(Recent.begin(), Recent, it->second.recent);
+            handle = it->second.pixels;
+            ++Hits;
+
+            return 0;
+        }
+    }
+
+//- Otherwise read it from the pixel cache or decode it without the lock,
+//  and add it.
+    image * decoded = new image();
+    handle = imageHandle(decoded);
+    const bool mapped = (Cache) && (Cache->find(fileName, info, *decoded));
+    if (!mapped)
+    {
+        if (decoded->load(fileName))
+            return 1;
+
+        if (Cache)
+            Cache->add(fileName, info, *decoded);
+    }
+
+    lock_guard<mutex> guard(Lock);
+    if (mapped)
+        ++Mapped;
+    else
+        ++Misses;
+    map<string, entry>::iterator it = Entries.find(key);
+    if (it != Entries.end())
+    {
+        // Decoded by another thread in the meantime.
+        Recent.splice(Recent.begin(), Recent, it->second.recent);
+        handle = it->second.pixels;
+
+        return 0;
+    }
+
+    Recent.push_front(key);
+    entry & added = Entries[key];
+    added.pixels = handle;
+    added.bytes = size_t(decoded->getWidth()) * decoded->getHeight() * 4;
+    added.recent = Recent.begin();
+    Used += added.bytes;
+    evict();
+
+    return 0;
+}
+
@@ -0,0 +1,90 @@
+/**
+ * @file    pool.h
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ *
+ * Interface for the pool of decoded images.
+ */
+
+#if !defined _POOL_H_INCLUDED_
+#define _POOL_H_INCLUDED_
+
+#include <stddef.h>
+#include <string>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+
+using namespace std;
+
+class image;
+class pixelCache;
+
+typedef shared_ptr<const image> imageHandle;
+
+
+/**
+ * @section imagePool class.
+ *
+ * Used to share decoded images, which are never changed once decoded. Each
+ * image is keyed by its file name, modification time and size, so a changed
+ * file is decoded again. Users hold a counted handle to an image. Once the
+ * pool holds more than its budget, the least recently used images that no
+ * one holds a handle to are dropped. Images the pool doesn't hold are taken
+ * from the pixel cache, if there is one, before decoding the file.
+ */
+class imagePool
+{
+private:
+    struct entry
+    {
+        imageHandle pixels;
+        size_t bytes;
+        list<string>::iterator recent;
+    };
+
+    mutex Lock;
+    size_t Budget;              // Bytes of images to keep.
+    size_t Used;                // Bytes of images held.
+    map<string, entry> Entries; // Images keyed by file, time and size.
+    list<string> Recent;        // Keys, most recently used first.
+    pixelCache * Cache;         // Decoded pixels kept between runs, or NULL.
+    size_t Hits;
+    size_t Mapped;
+    size_t Misses;
+
+    void evict(void);
+
+public:
+    imagePool(size_t budget, pixelCache * cache = NULL) :
+        Budget(budget), Used(0), Cache(cache), Hits(0), Mapped(0), Misses(0) {}
+
+    int get(const string & fileName, imageHandle & handle);
+    void trim(void);
+
+    size_t getHits(void) const { return Hits; }
+    size_t getMapped(void) const { return Mapped; }
+    size_t getMisses(void) const { return Misses; }
+    size_t getUsed(void) const { return Used; }
+};
+
+#endif //!defined _POOL_H_INCLUDED_
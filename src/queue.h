@@ -0,0 +1,164 @@
+/**
+ * @file    queue.h
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ *
+ * Interface for the bounded queue that connects the stages of the native
+ * renderer.
+ */
+
+#if !defined _QUEUE_H_INCLUDED_
+#define _QUEUE_H_INCLUDED_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+using namespace std;
+
+
+/**
+ * @section boundedQueue class.
+ *
+ * Used to pass values between threads without locks. Any number of threads
+ * can push and pop. The queue holds a fixed number of values, so a push
+ * fails while the queue is full and a pop fails while it is empty. Each cell
+ * has a sequence number that says whether it is ready to be filled or
+ * emptied on the current pass around the ring.
+ */
+template <typename T>
+class boundedQueue
+{
+private:
+    struct cell
+    {
+        atomic<size_t> sequence;
+        T value;
+    };
+
+    vector<cell> Cells;
+    size_t Mask;
+    atomic<size_t> Head;        // Position of the next value to pop.
+    atomic<size_t> Tail;        // Position of the next value to push.
+
+public:
+    boundedQueue(size_t capacity);
+
+    bool push(const T & value);
+    bool pop(T & value);
+};
+
+
+/**
+ * Construct a queue that holds at least the given number of values.
+ *
+ * @param  capacity - the minimum number of values held.
+ */
+template <typename T>
+boundedQueue<T>::boundedQueue(size_t capacity) : Head(0), Tail(0)
+{
+    size_t size = 2;
+    while (size < capacity)
+        size *= 2;
+
+    vector<cell> cells(size);
+    Cells.swap(cells);
+    Mask = size - 1;
+    for (size_t i = 0; i < size; ++i)
+    {
+        Cells[i].sequence.store(i, memory_order_relaxed);
+    }
+}
+
+
+/**
+ * Add a value to the back of the queue.
+ *
+ * @param  value - the value to add.
+ * @return true if the value was added, false if the queue is full.
+ */
+template <typename T>
+bool boundedQueue<T>::push(const T & value)
+{
+    size_t position = Tail.load(memory_order_relaxed);
+    for (;;)
+    {
+        cell & slot = Cells[position & Mask];
+        const intptr_t diff = intptr_t(slot.sequence.load(memory_order_acquire)) - intptr_t(position);
+        if (diff == 0)
+        {
+            if (Tail.compare_exchange_weak(position, position + 1, memory_order_relaxed))
+            {
+                slot.value = value;
+                slot.sequence.store(position + 1, memory_order_release);
+
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            position = Tail.load(memory_order_relaxed);
+        }
+    }
+}
+
+
+/**
+ * Take the value from the front of the queue.
+ *
+ * @param  value - returns the value.
+ * @return true if a value was taken, false if the queue is empty.
+ */
+template <typename T>
+bool boundedQueue<T>::pop(T & value)
+{
+    size_t position = Head.load(memory_order_relaxed);
+    for (;;)
+    {
+        cell & slot = Cells[position & Mask];
+        const intptr_t diff = intptr_t(slot.sequence.load(memory_order_acquire)) - intptr_t(position + 1);
+        if (diff == 0)
+        {
+            if (Head.compare_exchange_weak(position, position + 1, memory_order_relaxed))
+            {
+                value = slot.value;
+                slot.sequence.store(position + Mask + 1, memory_order_release);
+
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            position = Head.load(memory_order_relaxed);
+        }
+    }
+}
+
+#endif //!defined _QUEUE_H_INCLUDED_
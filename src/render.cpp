@@ -0,0 +1,1004 @@
+/**
+ * @file    render.cpp
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ * Native card renderer. Composites the cards in-process by performing the
+ * same render plans that are written to the script, so that no external
+ * 'convert' processes are needed. One thread decodes the assets ahead of
+ * the cards that need them, while a pool of workers composes, reduces and
+ * encodes the cards, stealing work from each other when idle.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include "cardgen.h"
+#include "image.h"
+#include "palette.h"
+#include "queue.h"
+#include "scheduler.h"
+#include "pool.h"
+#include "pixelcache.h"
+
+
+/**
+ * @section Internal constants and variables.
+ *
+ */
+
+static const size_t NO_CARD = SIZE_MAX;     // Marks the end of the cards in a queue.
+static const int SPINS = 64;                // Tries before a waiting thread sleeps.
+static const size_t BAND_PIXELS = 256 * 1024;   // Pixels per band of a large card.
+static const int BAND_ROWS = 16;            // Fewest rows in a band.
+
+
+/**
+ * @section assetStore structure.
+ *
+ * Used to share the decoded assets between the stages. Each asset file has a
+ * slot that is fixed before the stages start. The slot takes a handle to the
+ * decoded image from the pool before the first card that uses it is passed
+ * on to be composed, and lets it go once the last card that uses it is
+ * finished, so the pool can drop images that are no longer needed.
+ */
+struct assetStore
+{
+    map<string, size_t> slots;      // Slot of each asset file.
+    vector<string> files;           // Asset file in each slot.
+    vector<imageHandle> images;     // Decoded image in each slot.
+    vector<int> cards;              // Number of cards that use each slot.
+    vector<atomic<int> > users;     // Cards still to finish with each slot.
+    vector<vector<size_t> > first;  // Slots first used by each card.
+    vector<vector<size_t> > used;   // Slots used by each card.
+};
+
+
+/**
+ * @section renderCache structure.
+ *
+ * Used to share prepared images between the cards rendered by a worker. The
+ * images are only kept for the cards of one pack, so that a batch of packs
+ * doesn't hold the images of every pack it has drawn.
+ */
+struct renderCache
+{
+    filterType filter;              // Resampling filter for scaled assets.
+    const assetStore * store;       // Decoded assets shared by every stage.
+    const palette * shared;         // Palette shared by every card, or NULL.
+    int encoders;                   // Threads used to compress each card.
+    string pack;                    // Output directory of the cards drawn.
+    map<string, imageHandle> prepared;  // Scaled and rotated images keyed by
+                                    // file name, size and orientation.
+    map<string, image> blanks;      // Blank cards keyed by their steps.
+    map<string, image> bases;       // Shared base layers keyed by their steps.
+};
+
+
+/**
+ * @section main code.
+ *
+ */
+
+/**
+ * Get the decoded image for an asset file.
+ *
+ * @param  store - the decoded assets.
+ * @param  fileName - name of image file.
+ * @return the decoded image, which is empty if the file can't be read.
+ */
+static const image & getAsset(const assetStore & store, const string & fileName)
+{
+    static const image empty;
+
+    map<string, size_t>::const_iterator it = store.slots.find(fileName);
+    if (it == store.slots.end())
+    {
+        return empty;
+    }
+
+    const imageHandle & handle = store.images[it->second];
+
+    return handle ? *handle : empty;
+}
+
+
+/**
+ * Get an asset scaled to size, and rotated by 180 degrees if needed,
+ * preparing it only on first use.
+ *
+ * @param  store - the decoded assets.
+ * @param  prepared - prepared images keyed by file name, size and orientation.
+ * @param  op - the image over step.
+ * @param  filter - resampling filter.
+ * @return a handle to the prepared image, which is empty if the file can't
+ *         be read.
+ */
+static const imageHandle & getPreparedAsset(const assetStore & store, map<string, imageHandle> & prepared, const drawOp & op, filterType filter)
+{
+    const string key = op.file + " " + to_string(op.w) + "x" + to_string(op.h) + (op.rotated ? " r" : "");
+    map<string, imageHandle>::iterator it = prepared.find(key);
+    if (it != prepared.end())
+    {
+        return it->second;
+    }
+
+    const image & asset = getAsset(store, op.file);
+    image * variant = new image();
+    if (!asset.isEmpty())
+    {
+        *variant = ((op.w == 0) || (op.h == 0)) ? asset : asset.scale(op.w, op.h, filter);
+        if (op.rotated)
+            variant->rotate180();
+    }
+
+    return prepared[key] = imageHandle(variant);
+}
+
+
+/**
+ * Look up a colour used by a card.
+ *
+ * @param  name - colour name.
+ * @param  colour - the colour as 0xRRGGBBAA.
+ * @return error value or 0 if no errors.
+ */
+static int getColour(const string & name, uint32_t & colour)
+{
+    if (parseColour(name, colour))
+    {
+        cerr << "Unknown colour " << name << endl;
+
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Perform a sequence of render plan steps. A step fails if an image it
+ * draws can't be read, as 'convert' does.
+ *
+ * @param  canvas - card image being drawn.
+ * @param  first - the first step.
+ * @param  last - the step after the last step.
+ * @param  cache - prepared images shared between cards.
+ * @return error value or 0 if no errors.
+ */
+static int performSteps(image & canvas, renderPlan::const_iterator first, renderPlan::const_iterator last, renderCache & cache)
+{
+    uint32_t colour, stroke;
+
+    for (renderPlan::const_iterator op = first; op != last; ++op)
+    {
+        switch (op->type)
+        {
+        case drawOp::CANVAS:
+            if (getColour(op->colour, colour))
+                return 1;
+
+            canvas = image(op->w, op->h);
+            canvas.clear(colour);
+            break;
+
+        case drawOp::LOAD:
+            canvas = getAsset(*cache.store, op->file);
+            if (canvas.isEmpty())
+                return 1;
+            break;
+
+        case drawOp::ROUND_RECT:
+            if ((getColour(op->colour, colour)) || (getColour(op->stroke, stroke)))
+                return 1;
+
+            canvas.roundRectangle(op->x, op->y, op->w, op->h, op->radius, colour, stroke, op->strokeWidth);
+            break;
+
+        case drawOp::IMAGE_OVER:
+        {
+            if ((op->rotated) || (op->prepared))
+            {
+                const image & prepared = *getPreparedAsset(*cache.store, cache.prepared, *op, cache.filter);
+                if (prepared.isEmpty())
+                    return 1;
+
+                canvas.over(prepared, op->x, op->y);
+                break;
+            }
+
+            const image & asset = getAsset(*cache.store, op->file);
+            if (asset.isEmpty())
+                return 1;
+
+            if ((op->w == 0) || (op->h == 0))
+                canvas.over(asset, op->x, op->y);
+            else
+                canvas.over(asset.scale(op->w, op->h, cache.filter), op->x, op->y);
+            break;
+        }
+
+        case drawOp::ROTATE_180:
+            canvas.rotate180();
+            break;
+
+        case drawOp::RESIZE:
+            canvas = canvas.scale(op->w, op->h, cache.filter);
+            break;
+
+        case drawOp::QUANTIZE:
+            if (cache.shared)
+            {
+                canvas.quantise(*cache.shared);
+            }
+            else
+            {
+                histogram counts;
+                counts.add(canvas, 0);
+                canvas.quantise(palette(counts, op->colours));
+            }
+            break;
+
+        case drawOp::WRITE:
+            if (canvas.save(op->file, pngLevel, cache.encoders))
+            {
+                cerr << "Can't write image file " << op->file << endl;
+
+                return 1;
+            }
+            break;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Get a layer drawn by the steps at the start of a render plan, drawing it
+ * only on first use.
+ *
+ * @param  layers - drawn layers keyed by their steps.
+ * @param  below - layer drawn by the steps before split, or NULL.
+ * @param  first - the first step.
+ * @param  split - the first step not drawn by below.
+ * @param  last - the step after the last step of the layer.
+ * @param  cache - prepared images shared between cards.
+ * @return the layer, or NULL if it can't be drawn.
+ */
+static const image * getLayer(map<string, image> & layers, const image * below, renderPlan::const_iterator first, renderPlan::const_iterator split, renderPlan::const_iterator last, renderCache & cache)
+{
+    const string key = genConvertCommand(renderPlan(first, last));
+    map<string, image>::iterator it = layers.find(key);
+    if (it != layers.end())
+    {
+        return &it->second;
+    }
+
+    image layer;
+    if (below)
+    {
+        layer = *below;
+    }
+    if (performSteps(layer, split, last, cache))
+        return NULL;
+
+    return &layers.insert(make_pair(key, layer)).first->second;
+}
+
+
+/**
+ * Get the number of steps at the start of a render plan that draw the blank
+ * card and the base layer shared with other cards.
+ *
+ * @param  card - the card job.
+ * @return the number of steps.
+ */
+static size_t getBaseLength(const job & card)
+{
+    return max(getBlankLength(card.plan), card.baseLength);
+}
+
+
+/**
+ * Drop the prepared images of a worker when it starts a card of another
+ * pack. The cards are started in pack order, so images of a finished pack
+ * are not needed again, and cards still being drawn in bands hold their own
+ * handles.
+ *
+ * @param  card - the card job.
+ * @param  cache - prepared images used by the worker.
+ */
+static void startPack(const job & card, renderCache & cache)
+{
+    const string pack = card.fileName.substr(0, card.fileName.find_last_of('/') + 1);
+    if (pack == cache.pack)
+    {
+        return;
+    }
+
+    cache.pack = pack;
+    cache.prepared.clear();
+    cache.blanks.clear();
+    cache.bases.clear();
+}
+
+
+/**
+ * Start a card from a copy of its base layer. The blank card and the base
+ * layer shared with other cards are drawn only on first use.
+ *
+ * @param  card - the card job.
+ * @param  cache - prepared images shared between cards.
+ * @param  canvas - the card image.
+ * @return error value or 0 if no errors.
+ */
+static int drawBase(const job & card, renderCache & cache, image & canvas)
+{
+    const renderPlan::const_iterator first = card.plan.begin();
+    const size_t blankLength = getBlankLength(card.plan);
+    const size_t baseLength = getBaseLength(card);
+
+    if (blankLength)
+    {
+        const image * layer = getLayer(cache.blanks, NULL, first, first, first + blankLength, cache);
+        if ((layer) && (baseLength > blankLength))
+        {
+            layer = getLayer(cache.bases, layer, first, first + blankLength, first + baseLength, cache);
+        }
+        if (!layer)
+            return 1;
+
+        canvas = *layer;
+    }
+
+    return 0;
+}
+
+
+/**
+ * @section renderTask structure.
+ *
+ * Used to capture a piece of work on a card for the scheduler. A card is
+ * composed, possibly as bands of rows that are drawn by different workers,
+ * then encoded.
+ */
+struct renderTask
+{
+    enum taskType
+    {
+        COMPOSE,        // Draw the card up to its colour reduction.
+        BAND,           // Draw the images of the card over a band of rows.
+        ENCODE          // Reduce the colours of the card and write it.
+    };
+
+    taskType type;
+    size_t card;        // Index of the card in the job list.
+    int band;
+
+    renderTask(void) : type(COMPOSE), card(0), band(0) {}
+    renderTask(taskType t, size_t c, int b) : type(t), card(c), band(b) {}
+};
+
+
+/**
+ * @section cardState structure.
+ *
+ * Used to hold a card while it is being drawn. When the card is drawn in
+ * bands, each image step has its source image ready so that the bands only
+ * composite.
+ */
+struct cardState
+{
+    image canvas;
+    vector<const image *> sources;  // Image drawn by each step, or NULL.
+    vector<image> scaled;           // Images scaled for this card only.
+    vector<imageHandle> held;       // Prepared images used by the bands.
+    int count;                      // Bands the card is drawn in.
+    atomic<int> bands;              // Bands still to be drawn.
+
+    cardState(void) : count(1), bands(0) {}
+};
+
+
+/**
+ * @section pipeline structure.
+ *
+ * Used to connect the decode stage to the workers. Each card is passed on by
+ * its index in the job list. The decode queue bounds how far decoding runs
+ * ahead, and the workers only start a new card when there is nothing to
+ * finish or steal, so only a few cards are held in memory.
+ */
+struct pipeline
+{
+    const vector<job> & jobs;
+    assetStore & store;
+    boundedQueue<size_t> decoded;   // Cards ready to be composed.
+    vector<cardState> cards;        // State of each card being drawn.
+    vector<taskDeque<renderTask> > deques;  // Tasks of each worker.
+    atomic<size_t> finished;        // Cards finished.
+    atomic<bool> failed;            // Set if any card can't be drawn.
+
+    pipeline(const vector<job> & j, assetStore & s, size_t workers) :
+        jobs(j), store(s), decoded(workers * 2), cards(j.size()), deques(workers), finished(0), failed(false) {}
+};
+
+
+/**
+ * Find the assets used by the cards and give each a slot in the store.
+ *
+ * @param  jobs - list of card jobs.
+ * @param  store - the store to fill.
+ */
+static void findAssets(const vector<job> & jobs, assetStore & store)
+{
+    store.first.resize(jobs.size());
+    store.used.resize(jobs.size());
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        for (renderPlan::const_iterator op = jobs[i].plan.begin(); op != jobs[i].plan.end(); ++op)
+        {
+            if ((op->type != drawOp::LOAD) && (op->type != drawOp::IMAGE_OVER))
+                continue;
+
+            map<string, size_t>::const_iterator it = store.slots.find(op->file);
+            if (it == store.slots.end())
+            {
+                it = store.slots.insert(make_pair(op->file, store.files.size())).first;
+                store.first[i].push_back(it->second);
+                store.files.push_back(op->file);
+                store.cards.push_back(0);
+            }
+            if (find(store.used[i].begin(), store.used[i].end(), it->second) == store.used[i].end())
+            {
+                store.used[i].push_back(it->second);
+                ++store.cards[it->second];
+            }
+        }
+    }
+    store.images.resize(store.files.size());
+
+    vector<atomic<int> > users(store.files.size());
+    store.users.swap(users);
+}
+
+
+/**
+ * Let go of the assets used by a card once it is finished. Each asset is
+ * let go once the last card that uses it is finished.
+ *
+ * @param  stages - the pipeline.
+ * @param  card - index of the card.
+ */
+static void finishCard(pipeline & stages, size_t card)
+{
+    assetStore & store = stages.store;
+
+    const vector<size_t> & slots = store.used[card];
+    for (vector<size_t>::const_iterator slot = slots.begin(); slot != slots.end(); ++slot)
+    {
+        if (--store.users[*slot] == 0)
+            store.images[*slot].reset();
+    }
+    ++stages.finished;
+}
+
+
+/**
+ * Get the first step of a render plan that is performed by the encode task,
+ * which is the colour reduction or, failing that, the write.
+ *
+ * @param  plan - the render plan of the card.
+ * @return the first step of the encode task.
+ */
+static renderPlan::const_iterator getSplit(const renderPlan & plan)
+{
+    renderPlan::const_iterator split = plan.begin();
+    while ((split != plan.end()) && (split->type != drawOp::QUANTIZE) && (split->type != drawOp::WRITE))
+        ++split;
+
+    return split;
+}
+
+
+/**
+ * Wait before trying again. The thread yields for the first few tries, then
+ * sleeps, so that idle threads don't take time from busy ones.
+ *
+ * @param  spins - number of tries so far.
+ */
+static void backOff(int spins)
+{
+    if (spins < SPINS)
+        this_thread::yield();
+    else
+        this_thread::sleep_for(chrono::microseconds(100));
+}
+
+
+/**
+ * Add a card to a queue, waiting while the queue is full.
+ *
+ * @param  queue - the queue.
+ * @param  card - index of the card.
+ * @param  failed - set if any card can't be drawn.
+ * @return true if the card was added, false if the run failed first.
+ */
+static bool pushCard(boundedQueue<size_t> & queue, size_t card, const atomic<bool> & failed)
+{
+    for (int spins = 0; !queue.push(card); ++spins)
+    {
+        if (failed)
+            return false;
+
+        backOff(spins);
+    }
+
+    return true;
+}
+
+
+/**
+ * The decode stage. Decodes the assets of each card in turn, then passes the
+ * card on to be composed. This runs ahead of the workers by as many cards
+ * as the queue holds, so the assets of the next cards are decoded while the
+ * current cards are drawn.
+ *
+ * @param  stages - the pipeline.
+ * @param  pool - the decoded images.
+ */
+static void decodeStage(pipeline & stages, imagePool & pool)
+{
+    assetStore & store = stages.store;
+
+    for (size_t slot = 0; slot < store.files.size(); ++slot)
+    {
+        store.users[slot] = store.cards[slot];
+    }
+
+    for (size_t i = 0; i < stages.jobs.size(); ++i)
+    {
+        const vector<size_t> & slots = store.first[i];
+        for (vector<size_t>::const_iterator slot = slots.begin(); slot != slots.end(); ++slot)
+        {
+            if (pool.get(store.files[*slot], store.images[*slot]))
+            {
+                cerr << "Can't read image file " << store.files[*slot] << endl;
+            }
+        }
+
+        if (!pushCard(stages.decoded, i, stages.failed))
+            return;
+    }
+
+    for (size_t i = 0; i < stages.deques.size(); ++i)
+    {
+        if (!pushCard(stages.decoded, NO_CARD, stages.failed))
+            return;
+    }
+}
+
+
+/**
+ * Get the number of bands to draw a card in. Only large cards are split,
+ * and only when every step after the base layer composites an image, as a
+ * band of rows can then be drawn without the rest of the card.
+ *
+ * @param  stages - the pipeline.
+ * @param  card - index of the card.
+ * @param  split - the first step of the encode task.
+ * @return the number of bands, 1 if the card is drawn whole.
+ */
+static int getBands(const pipeline & stages, size_t card, renderPlan::const_iterator split)
+{
+    const image & canvas = stages.cards[card].canvas;
+    const size_t pixels = size_t(canvas.getWidth()) * canvas.getHeight();
+    if ((stages.deques.size() < 2) || (pixels < BAND_PIXELS * 2))
+        return 1;
+
+    const renderPlan & plan = stages.jobs[card].plan;
+    for (renderPlan::const_iterator op = plan.begin() + getBaseLength(stages.jobs[card]); op != split; ++op)
+    {
+        if (op->type != drawOp::IMAGE_OVER)
+            return 1;
+    }
+
+    return min<int>(canvas.getHeight() / BAND_ROWS, pixels / BAND_PIXELS);
+}
+
+
+/**
+ * Get the image drawn by each image step of a card that is drawn in bands.
+ * Shared assets are taken from the worker's prepared images, and the card
+ * holds a handle to each so that they outlive the worker dropping them. Any
+ * other scaled images are held with the card.
+ *
+ * @param  stages - the pipeline.
+ * @param  card - index of the card.
+ * @param  split - the first step of the encode task.
+ * @param  cache - prepared images used by the worker.
+ * @return error value or 0 if no errors.
+ */
+static int getSources(pipeline & stages, size_t card, renderPlan::const_iterator split, renderCache & cache)
+{
+    cardState & state = stages.cards[card];
+    const renderPlan & plan = stages.jobs[card].plan;
+    const renderPlan::const_iterator first = plan.begin() + getBaseLength(stages.jobs[card]);
+
+    state.sources.assign(split - first, NULL);
+    state.scaled.assign(split - first, image());
+    state.held.clear();
+    for (renderPlan::const_iterator op = first; op != split; ++op)
+    {
+        const size_t i = op - first;
+        if ((op->rotated) || (op->prepared))
+        {
+            const imageHandle & prepared = getPreparedAsset(*cache.store, cache.prepared, *op, cache.filter);
+            if (prepared->isEmpty())
+                return 1;
+
+            state.held.push_back(prepared);
+            state.sources[i] = prepared.get();
+            continue;
+        }
+
+        const image & asset = getAsset(*cache.store, op->file);
+        if (asset.isEmpty())
+            return 1;
+
+        if ((op->w == 0) || (op->h == 0))
+        {
+            state.sources[i] = &asset;
+        }
+        else
+        {
+            state.scaled[i] = asset.scale(op->w, op->h, cache.filter);
+            state.sources[i] = &state.scaled[i];
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Finish drawing a card. When sampling, its colours are added to the
+ * histogram and the card is done, otherwise it is queued to be encoded.
+ *
+ * @param  stages - the pipeline.
+ * @param  card - index of the card.
+ * @param  worker - the worker.
+ * @param  counts - histogram of the sampled colours, or NULL to draw the cards.
+ */
+static void finishCompose(pipeline & stages, size_t card, size_t worker, histogram * counts)
+{
+    cardState & state = stages.cards[card];
+    state.sources.clear();
+    state.scaled.clear();
+    state.held.clear();
+
+    if (!counts)
+    {
+        stages.deques[worker].push(renderTask(renderTask::ENCODE, card, 0));
+
+        return;
+    }
+
+    const renderPlan & plan = stages.jobs[card].plan;
+    const renderPlan::const_iterator split = getSplit(plan);
+    if ((split != plan.end()) && (split->type == drawOp::QUANTIZE))
+        counts->add(state.canvas, 0);
+    state.canvas = image();
+    finishCard(stages, card);
+}
+
+
+/**
+ * Perform a task.
+ *
+ * @param  stages - the pipeline.
+ * @param  task - the task.
+ * @param  worker - the worker.
+ * @param  cache - prepared images used by the worker.
+ * @param  counts - histogram of the sampled colours, or NULL to draw the cards.
+ * @return error value or 0 if no errors.
+ */
+static int runTask(pipeline & stages, const renderTask & task, size_t worker, renderCache & cache, histogram * counts)
+{
+    const job & card = stages.jobs[task.card];
+    const renderPlan::const_iterator split = getSplit(card.plan);
+    cardState & state = stages.cards[task.card];
+
+    switch (task.type)
+    {
+    case renderTask::COMPOSE:
+    {
+        startPack(card, cache);
+        if (drawBase(card, cache, state.canvas))
+            return 1;
+
+        const int bands = getBands(stages, task.card, split);
+        if (bands < 2)
+        {
+            if (performSteps(state.canvas, card.plan.begin() + getBaseLength(card), split, cache))
+                return 1;
+
+            finishCompose(stages, task.card, worker, counts);
+            break;
+        }
+
+        if (getSources(stages, task.card, split, cache))
+            return 1;
+
+        state.count = bands;
+        state.bands = bands;
+        for (int band = 0; band < bands; ++band)
+        {
+            stages.deques[worker].push(renderTask(renderTask::BAND, task.card, band));
+        }
+        break;
+    }
+
+    case renderTask::BAND:
+    {
+        const int height = state.canvas.getHeight();
+        const int top = height * task.band / state.count;
+        const int bottom = height * (task.band + 1) / state.count;
+        const renderPlan::const_iterator first = card.plan.begin() + getBaseLength(card);
+        for (renderPlan::const_iterator op = first; op != split; ++op)
+        {
+            const image * source = state.sources[op - first];
+            if (source)
+                state.canvas.over(*source, op->x, op->y, top, bottom);
+        }
+
+        if (--state.bands == 0)
+            finishCompose(stages, task.card, worker, counts);
+        break;
+    }
+
+    case renderTask::ENCODE:
+        if (performSteps(state.canvas, split, card.plan.end(), cache))
+            return 1;
+
+        state.canvas = image();
+        finishCard(stages, task.card);
+        break;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Find a task for a worker. The worker takes its own newest task first, then
+ * steals the oldest task of another worker, then starts a new card.
+ *
+ * @param  stages - the pipeline.
+ * @param  worker - the worker.
+ * @param  task - returns the task.
+ * @param  more - cleared once the worker has seen the end of the cards.
+ * @param  stats - counts the stolen tasks.
+ * @return true if a task was found, false otherwise.
+ */
+static bool findTask(pipeline & stages, size_t worker, renderTask & task, bool & more, workerStats & stats)
+{
+    if (stages.deques[worker].pop(task))
+        return true;
+
+    const size_t workers = stages.deques.size();
+    for (size_t i = 1; i < workers; ++i)
+    {
+        if (stages.deques[(worker + i) % workers].steal(task))
+        {
+            ++stats.stolen;
+
+            return true;
+        }
+    }
+
+    size_t card;
+    if ((more) && (stages.decoded.pop(card)))
+    {
+        if (card != NO_CARD)
+        {
+            task = renderTask(renderTask::COMPOSE, card, 0);
+
+            return true;
+        }
+        more = false;
+    }
+
+    return false;
+}
+
+
+/**
+ * Run the tasks of a worker until every card is finished.
+ *
+ * @param  stages - the pipeline.
+ * @param  worker - the worker.
+ * @param  cache - prepared images used by the worker.
+ * @param  counts - histogram of the sampled colours, or NULL to draw the cards.
+ * @param  stats - how the worker spent its time.
+ */
+static void renderWorker(pipeline & stages, size_t worker, renderCache & cache, histogram * counts, workerStats & stats)
+{
+    const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    bool more = true;
+    int spins = 0;
+    while ((!stages.failed) && (stages.finished < stages.jobs.size()))
+    {
+        renderTask task;
+        if (!findTask(stages, worker, task, more, stats))
+        {
+            backOff(spins++);
+            continue;
+        }
+        spins = 0;
+
+        const chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+        if (runTask(stages, task, worker, cache, counts))
+        {
+            cerr << "Can't render " << stages.jobs[task.card].fileName << " - aborting!" << endl;
+            stages.failed = true;
+        }
+        stats.busy += chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        ++stats.tasks;
+    }
+
+    stats.elapsed += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+
+/**
+ * Render the cards in the job list, with a worker for each cache. The
+ * calling thread runs the decode stage while the workers share out the
+ * tasks.
+ *
+ * @param  jobs - list of card jobs.
+ * @param  store - the decoded assets.
+ * @param  pool - the decoded images.
+ * @param  caches - prepared images used by each worker.
+ * @param  samples - histogram for each worker, or NULL to draw the cards.
+ * @param  stats - how each worker spent its time.
+ * @return error value or 0 if no errors.
+ */
+static int runPipeline(const vector<job> & jobs, assetStore & store, imagePool & pool, vector<renderCache> & caches, vector<histogram> * samples, vector<workerStats> & stats)
+{
+    pipeline stages(jobs, store, caches.size());
+
+    vector<thread> workers;
+    for (size_t i = 0; i < caches.size(); ++i)
+    {
+        histogram * counts = samples ? &(*samples)[i] : NULL;
+        workers.push_back(thread(renderWorker, ref(stages), i, ref(caches[i]), counts, ref(stats[i])));
+    }
+
+    decodeStage(stages, pool);
+    for (vector<thread>::iterator it = workers.begin(); it != workers.end(); ++it)
+    {
+        it->join();
+    }
+    pool.trim();
+
+    return stages.failed ? 1 : 0;
+}
+
+
+/**
+ * Report how each worker spent its time, and how well the decoded images
+ * were reused.
+ *
+ * @param  stats - how each worker spent its time.
+ * @param  pool - the decoded images.
+ */
+static void reportStats(const vector<workerStats> & stats, const imagePool & pool)
+{
+    cout << "Images: " << pool.getHits() << " reused, " << pool.getMapped() << " mapped, " << pool.getMisses() << " decoded, " << (pool.getUsed() + 512 * 1024) / (1024 * 1024) << " MB held" << endl;
+    for (size_t i = 0; i < stats.size(); ++i)
+    {
+        const double used = stats[i].elapsed > 0.0 ? 100.0 * stats[i].busy / stats[i].elapsed : 0.0;
+        cout << "Worker " << i << ": " << stats[i].tasks << " tasks, " << stats[i].stolen << " stolen, " <<
+            fixed << setprecision(1) << used << "% busy" << endl;
+    }
+}
+
+
+/**
+ * Render the cards in the job list directly, without running the commands.
+ * The cards are shared between the workers, one per job, each with its own
+ * prepared images. With a shared palette, the cards are first drawn to
+ * sample their colours, then drawn again and reduced to the palette. The
+ * decoded images are kept in the pixel cache file for the next run.
+ *
+ * @param  jobs - list of card jobs.
+ * @return error value or 0 if no errors.
+ */
+int renderJobs(const vector<job> & jobs)
+{
+    assetStore store;
+    findAssets(jobs, store);
+    pixelCache pixels;
+    if (pixelCacheFilename.length())
+    {
+        pixels.open(pixelCacheFilename);
+    }
+    imagePool pool(size_t(imageCacheMB) * 1024 * 1024, pixelCacheFilename.length() ? &pixels : NULL);
+
+    const size_t count = max<size_t>(1, min<size_t>(jobs.size(), jobCount));
+    vector<renderCache> caches(count);
+    for (vector<renderCache>::iterator it = caches.begin(); it != caches.end(); ++it)
+    {
+        parseFilter(filterName, it->filter);
+        it->store = &store;
+        it->shared = NULL;
+        it->encoders = max<size_t>(1, thread::hardware_concurrency() / count);
+    }
+
+    vector<workerStats> stats(count);
+    palette shared;
+    if (sharedPalette)
+    {
+        vector<histogram> samples(count);
+        if (runPipeline(jobs, store, pool, caches, &samples, stats))
+            return 1;
+
+        int colours = 256;
+        histogram counts;
+        for (size_t i = 0; i < count; ++i)
+        {
+            counts.add(samples[i]);
+        }
+        for (vector<job>::const_iterator it = jobs.begin(); it != jobs.end(); ++it)
+        {
+            for (renderPlan::const_iterator op = it->plan.begin(); op != it->plan.end(); ++op)
+            {
+                if (op->type == drawOp::QUANTIZE)
+                    colours = min(colours, op->colours);
+            }
+        }
+
+        shared = palette(counts, colours);
+        for (vector<renderCache>::iterator it = caches.begin(); it != caches.end(); ++it)
+        {
+            it->shared = &shared;
+        }
+    }
+
+    const int ret = runPipeline(jobs, store, pool, caches, NULL, stats);
+    if (pixelCacheFilename.length())
+    {
+        pixels.save(pixelCacheFilename);
+    }
+    if (showStats)
+    {
+        reportStats(stats, pool);
+    }
+
+    return ret;
+}
@@ -0,0 +1,127 @@
+/**
+ * @file    scheduler.h
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ *
+ * Interface for the work stealing task deque used by the native renderer.
+ */
+
+#if !defined _SCHEDULER_H_INCLUDED_
+#define _SCHEDULER_H_INCLUDED_
+
+#include <stddef.h>
+#include <deque>
+#include <mutex>
+
+using namespace std;
+
+
+/**
+ * @section taskDeque class.
+ *
+ * Used to hold the tasks of one worker. The worker adds and takes tasks at
+ * the back, so it finishes the newest task first while its data is still in
+ * the cache. Idle workers steal from the front, taking the oldest task,
+ * which is usually the largest piece of work left.
+ */
+template <typename T>
+class taskDeque
+{
+private:
+    mutex Lock;
+    deque<T> Tasks;
+
+public:
+    void push(const T & task);
+    bool pop(T & task);
+    bool steal(T & task);
+};
+
+
+/**
+ * Add a task to the back of the deque.
+ *
+ * @param  task - the task.
+ */
+template <typename T>
+void taskDeque<T>::push(const T & task)
+{
+    lock_guard<mutex> guard(Lock);
+    Tasks.push_back(task);
+}
+
+
+/**
+ * Take the newest task, for the worker that owns the deque.
+ *
+ * @param  task - returns the task.
+ * @return true if a task was taken, false if the deque is empty.
+ */
+template <typename T>
+bool taskDeque<T>::pop(T & task)
+{
+    lock_guard<mutex> guard(Lock);
+    if (Tasks.empty())
+        return false;
+
+    task = Tasks.back();
+    Tasks.pop_back();
+
+    return true;
+}
+
+
+/**
+ * Take the oldest task, for another worker.
+ *
+ * @param  task - returns the task.
+ * @return true if a task was taken, false if the deque is empty.
+ */
+template <typename T>
+bool taskDeque<T>::steal(T & task)
+{
+    lock_guard<mutex> guard(Lock);
+    if (Tasks.empty())
+        return false;
+
+    task = Tasks.front();
+    Tasks.pop_front();
+
+    return true;
+}
+
+
+/**
+ * @section workerStats structure.
+ *
+ * Used to record how a worker spent its time.
+ */
+struct workerStats
+{
+    size_t tasks;           // Tasks run.
+    size_t stolen;          // Tasks stolen from other workers.
+    double busy;            // Seconds spent running tasks.
+    double elapsed;         // Seconds the worker was running.
+
+    workerStats(void) : tasks(0), stolen(0), busy(0.0), elapsed(0.0) {}
+};
+
+#endif //!defined _SCHEDULER_H_INCLUDED_
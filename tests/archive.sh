@@ -0,0 +1,40 @@
+#!/bin/sh
+#
+# Render a pack from the asset images packed into an uncompressed tar, a
+# pax tar and a stored zip with --assets, and check that every card is
+# byte for byte the same as the pack rendered from the extracted images.
+# A compressed archive must be rejected.
+
+. "$srcdir/common.sh"
+
+cd "$work"
+tar -cf top.tar assets
+(cd assets && tar --format=pax -cf ../pax.tar .) || rm -f pax.tar
+if command -v zip > /dev/null
+then
+    (cd assets && zip -q -0 -r ../stored.zip .)
+fi
+gzip -c top.tar > top.tar.gz
+
+(cd assets && "$CARDGEN" --render --no-pixel-cache -o pack > /dev/null)
+
+for archive in top.tar pax.tar stored.zip
+do
+    if [ ! -f "$archive" ]
+    then
+        echo "SKIP: can't make $archive here"
+        continue
+    fi
+
+    mkdir "from_$archive"
+    (cd "from_$archive" && "$CARDGEN" --render --no-pixel-cache --assets "../$archive" -o pack > /dev/null)
+    same_cards assets/cards/pack "from_$archive/cards/pack"
+done
+
+mkdir from_gzip
+if (cd from_gzip && "$CARDGEN" --render --no-pixel-cache --assets ../top.tar.gz -o pack > /dev/null 2>&1)
+then
+    echo "FAIL: the compressed archive was accepted"
+    exit 1
+fi
+echo "top.tar.gz rejected"
@@ -0,0 +1,17 @@
+#!/bin/sh
+#
+# Check that the card image cache "cards/.cache" keeps its own copy of each
+# card: a run without --cache that redraws the cards in place must not
+# change the cached images, so a later --cache run still copies the right
+# cards.
+
+. "$srcdir/common.sh"
+
+cd "$work/assets"
+
+"$CARDGEN" --render --no-pixel-cache -o white > /dev/null
+
+"$CARDGEN" --render --no-pixel-cache --cache -o pack > /dev/null
+"$CARDGEN" --render --no-pixel-cache -c blue -o pack > /dev/null
+"$CARDGEN" --render --no-pixel-cache --cache -o pack | grep '^Cache:'
+same_cards cards/white cards/pack
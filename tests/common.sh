@@ -0,0 +1,41 @@
+# Shared set up for the end to end checks, sourced by each check script.
+#
+# Makes a scratch directory holding a generated set of asset images in
+# "$work/assets", removed again when the check ends. CARDGEN and MKASSETS are
+# set by 'make check'.
+
+set -e
+
+work=$(mktemp -d "${TMPDIR:-/tmp}/cardgen-check.XXXXXX")
+trap 'rm -rf "$work"' EXIT
+
+mkdir "$work/assets"
+"$MKASSETS" "$work/assets"
+
+
+# Check that two directories hold the same card images, byte for byte.
+#
+# $1 - the first directory.
+# $2 - the second directory.
+same_cards()
+{
+    count=0
+    for file in "$1"/*
+    do
+        [ -f "$file" ] || continue
+        if ! cmp -s "$file" "$2/${file##*/}"
+        then
+            echo "FAIL: ${file##*/} differs between $1 and $2"
+            return 1
+        fi
+        count=$((count + 1))
+    done
+
+    if [ "$count" -eq 0 ] || [ "$count" -ne "$(ls "$2" | wc -l)" ]
+    then
+        echo "FAIL: $1 has $count cards and $2 has $(ls "$2" | wc -l)"
+        return 1
+    fi
+
+    echo "$count cards identical in $1 and $2"
+}
@@ -0,0 +1,27 @@
+#!/bin/sh
+#
+# Generate and render several different packs in one batch on several
+# threads, then render each pack on its own on one thread, and check that
+# every card is byte for byte the same. '-j 4' sets the number of threads
+# used to generate the packs too, so the packs are generated concurrently
+# however many CPUs the host has.
+
+. "$srcdir/common.sh"
+
+cd "$work/assets"
+cat > packs.txt <<EOF
+-o small -w 190 -h 266
+-o ivory -w 500 -h 700 -c ivory
+-o plain --ImagePipOff
+-o aspect -a -w 300 -h 420 --CentreX 12
+EOF
+
+"$CARDGEN" --render -j 4 --no-pixel-cache --batch packs.txt > /dev/null
+
+while read -r options
+do
+    name=${options#-o }
+    name=${name%% *}
+    "$CARDGEN" --render -j 1 --no-pixel-cache $options -o "single_$name" > /dev/null
+    same_cards "cards/$name" "cards/single_$name"
+done < packs.txt
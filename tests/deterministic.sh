@@ -0,0 +1,22 @@
+#!/bin/sh
+#
+# Render the same pack on 1, 3 and 8 threads, with and without a shared
+# palette, and check that the cards are byte for byte the same whatever
+# order the threads finish in.
+
+. "$srcdir/common.sh"
+
+cd "$work/assets"
+
+for jobs in 1 3 8
+do
+    "$CARDGEN" --render -j $jobs --no-pixel-cache -o "jobs_$jobs" > /dev/null
+done
+same_cards cards/jobs_1 cards/jobs_3
+same_cards cards/jobs_1 cards/jobs_8
+
+for jobs in 1 8
+do
+    "$CARDGEN" --render -j $jobs --no-pixel-cache --shared-palette -o "shared_$jobs" > /dev/null
+done
+same_cards cards/shared_1 cards/shared_8
@@ -0,0 +1,161 @@
+/**
+ * @file    mkassets.cpp
+ * @author  Phil Lockett <phillockett65@gmail.com>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * https://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * 'cardgen' is a playing card image generator.
+ *
+ * Test helper. Writes a set of generated asset images with the same names
+ * and sizes as the 'CardWork' environment, so the checks can draw a whole
+ * pack without the real images.
+ */
+
+#include <png.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+/**
+ * @section Internal constants and variables.
+ *
+ */
+
+static const char * const suits[] = { "C", "D", "H", "S" };
+static const char * const cards[] = { "A", "2", "3", "4", "5", "6", "7", "8", "9", "10", "J", "Q", "K" };
+static const char * const faces[] = { "J", "Q", "K" };
+
+static const struct
+{
+    const char * name;
+    int width;
+    int height;
+} boneyard[] = {
+    { "Back.png", 250, 350 },
+    { "ImageMagickURL.png", 300, 16 },
+    { "ImageMagickUsage.png", 300, 20 },
+    { "ImageMagick_logo.svg.png", 256, 256 },
+};
+
+
+/**
+ * @section main code.
+ *
+ */
+
+/**
+ * Write an image of a striped ellipse with a soft edge on a transparent
+ * background, so the images have both solid and partly transparent pixels.
+ * The colours depend on the seed, so each image is different.
+ *
+ * @param  fileName - name of the png file.
+ * @param  width - width of the image.
+ * @param  height - height of the image.
+ * @param  seed - used to vary the colours.
+ * @return error value or 0 if no errors.
+ */
+static int writeAsset(const string & fileName, int width, int height, int seed)
+{
+    vector<uint8_t> pixels(size_t(width) * height * 4);
+    const double edge = min(width, height) / 2.0;
+    uint8_t * p = pixels.data();
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x, p += 4)
+        {
+            const double dx = (x + 0.5) / width * 2.0 - 1.0;
+            const double dy = (y + 0.5) / height * 2.0 - 1.0;
+            const double alpha = (1.0 - sqrt(dx * dx + dy * dy)) * edge;
+
+            p[0] = (seed * 37 + x * 5) & 0xFF;
+            p[1] = (seed * 91 + y * 3) & 0xFF;
+            p[2] = (((x / 4) ^ (y / 4)) & 1) ? 0xFF : (seed * 13) & 0xFF;
+            p[3] = alpha <= 0.0 ? 0 : alpha >= 1.0 ? 0xFF : uint8_t(alpha * 255.0);
+        }
+    }
+
+    png_image png;
+    memset(&png, 0, sizeof(png));
+    png.version = PNG_IMAGE_VERSION;
+    png.width = width;
+    png.height = height;
+    png.format = PNG_FORMAT_RGBA;
+    if (!png_image_write_to_file(&png, fileName.c_str(), 0, pixels.data(), 0, NULL))
+    {
+        cerr << "Can't write " << fileName << " - aborting!" << endl;
+
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * System entry point.
+ *
+ * @param  argc - command line argument count.
+ * @param  argv - command line argument vector.
+ * @return error value or 0 if no errors.
+ */
+int main(int argc, char *argv[])
+{
+    if (argc != 2)
+    {
+        cerr << "Usage: " << argv[0] << " directory" << endl;
+
+        return 1;
+    }
+
+    const string top = string(argv[1]) + "/";
+    const char * const directories[] = { "indices", "indices/1", "pips", "pips/1", "faces", "faces/1", "boneyard" };
+    for (size_t i = 0; i < sizeof(directories) / sizeof(directories[0]); ++i)
+    {
+        mkdir((top + directories[i]).c_str(), 0755);
+    }
+
+    int seed = 0;
+    int failures = 0;
+    for (size_t s = 0; s < sizeof(suits) / sizeof(suits[0]); ++s)
+    {
+        failures += writeAsset(top + "pips/1/" + suits[s] + ".png", 60, 64, ++seed);
+        for (size_t c = 0; c < sizeof(cards) / sizeof(cards[0]); ++c)
+        {
+            failures += writeAsset(top + "indices/1/" + suits[s] + cards[c] + ".png", 20, 40, ++seed);
+        }
+        for (size_t f = 0; f < sizeof(faces) / sizeof(faces[0]); ++f)
+        {
+            failures += writeAsset(top + "faces/1/" + suits[s] + faces[f] + ".png", 220, 215, ++seed);
+        }
+    }
+    failures += writeAsset(top + "faces/1/CJoker.png", 300, 420, ++seed);
+
+    for (size_t i = 0; i < sizeof(boneyard) / sizeof(boneyard[0]); ++i)
+    {
+        failures += writeAsset(top + "boneyard/" + boneyard[i].name, boneyard[i].width, boneyard[i].height, ++seed);
+    }
+
+    return failures ? 1 : 0;
+}
+
@@ -0,0 +1,44 @@
+#!/bin/sh
+#
+# Check the decoded image cache ".cardgen-pixels": a second run maps every
+# image instead of decoding it and draws the same cards as a run without
+# the cache, and an asset that changes is decoded again. Adding images to
+# the cache must not stop the pool dropping them.
+
+. "$srcdir/common.sh"
+
+cd "$work/assets"
+
+# Report the "Images:" line of the --stats output of a run.
+#
+# $1 - the output directory.
+# $2... - any other options.
+images()
+{
+    output=$1
+    shift
+    "$CARDGEN" --render --stats -o "$output" "$@" 2>&1 | grep '^Images:'
+}
+
+"$CARDGEN" --render --no-pixel-cache -o reference > /dev/null
+
+cold=$(images cold --image-cache-mb 0)
+echo "cold: $cold"
+[ -f .cardgen-pixels ] || { echo "FAIL: .cardgen-pixels was not written"; exit 1; }
+echo "$cold" | grep -q ' 0 MB held' ||
+    { echo "FAIL: the cold run held images with --image-cache-mb 0"; exit 1; }
+same_cards cards/reference cards/cold
+
+warm=$(images warm)
+echo "warm: $warm"
+echo "$warm" | grep -q ' 0 reused, [1-9][0-9]* mapped, 0 decoded,' ||
+    { echo "FAIL: the warm run decoded images"; exit 1; }
+same_cards cards/reference cards/warm
+
+cp faces/1/CJoker.png pips/1/D.png
+"$CARDGEN" --render --no-pixel-cache -o changed_reference > /dev/null
+changed=$(images changed)
+echo "changed: $changed"
+echo "$changed" | grep -q ' 1 decoded,' ||
+    { echo "FAIL: the changed asset was not decoded again"; exit 1; }
+same_cards cards/changed_reference cards/changed
@@ -0,0 +1,20 @@
+#!/bin/sh
+#
+# Check that --render fails, as the script's 'convert' commands do, when an
+# asset image can't be read, rather than drawing the card without it.
+
+. "$srcdir/common.sh"
+
+cd "$work/assets"
+head -c 100 faces/1/CK.png > broken.png
+mv broken.png faces/1/CK.png
+
+for jobs in 1 4
+do
+    if "$CARDGEN" --render -j $jobs --no-pixel-cache -o "jobs_$jobs" > /dev/null 2>&1
+    then
+        echo "FAIL: the card was drawn without faces/1/CK.png with -j $jobs"
+        exit 1
+    fi
+    echo "-j $jobs failed on the unreadable image"
+done